@@ -0,0 +1,277 @@
+#include "BatchCarver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+#include "BoundedQueue.hpp"
+#include "ImageReader.hpp"
+#include "Instrumentation.hpp"
+#include "MappedImage.hpp"
+#include "SeamCache.hpp"
+
+namespace {
+    /**
+     * @brief One image on its way through the pipeline.
+     */
+    struct Job {
+        std::string path;
+        cv::Mat image;
+        /* the mapped files, see BatchOptions::mappedFiles */
+        std::unique_ptr<seam::MappedImage> mappedInput;
+        std::unique_ptr<seam::MappedImage> mappedOutput;
+    };
+
+    typedef seam::BoundedQueue<Job> JobQueue;
+
+    /**
+     * @brief Shared state of a batch run.
+     */
+    struct Batch {
+        const seam::BatchOptions& options;
+        std::unique_ptr<seam::SeamCache> cache;
+        std::atomic<int> failed;
+        std::mutex reportMutex;
+
+        explicit Batch(const seam::BatchOptions& options) : options(options), failed(0)
+        {
+            if (!options.cacheDirectory.empty())
+                cache.reset(new seam::SeamCache(options.cacheDirectory));
+        }
+
+        void warning(const std::string& message)
+        {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            std::cerr << "warning: " << message << "\n";
+        }
+
+        void error(const std::string& message)
+        {
+            failed++;
+            std::lock_guard<std::mutex> lock(reportMutex);
+            std::cerr << "error: " << message << "\n";
+        }
+
+        void report(const std::string& message)
+        {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            std::cout << message << "\n";
+        }
+    };
+
+    std::string fileName(const std::string& path)
+    {
+        std::string::size_type slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    std::string outputPath(const Batch& batch, const Job& job)
+    {
+        return batch.options.outputDirectory + "/" + fileName(job.path);
+    }
+
+    bool decodeJob(Batch& batch, Job& job)
+    {
+        SEAM_SCOPED_TIMER("batch.decode");
+        if (batch.options.mappedFiles && seam::isPnmPath(job.path)) {
+            job.mappedInput.reset(new seam::MappedImage());
+            if (job.mappedInput->open(job.path)) {
+                job.image = job.mappedInput->image();
+                return true;
+            }
+            /* e.g. an ASCII PGM file, which is decoded like any other image */
+            job.mappedInput.reset();
+        }
+        job.image = ImageReader::readImage(job.path);
+        if (job.image.empty()) {
+            batch.error("can't read " + job.path);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns the seams of a removal order, see removalOrderVertical(), in the order of removal.
+     */
+    void orderSeams(const cv::Mat& order, int count, bool vertical, std::vector<std::vector<int>>& seams)
+    {
+        seams.assign(count, std::vector<int>(vertical ? order.rows : order.cols));
+        for (int i = 0; i < order.rows; i++) {
+            const uint16_t* row = order.ptr<uint16_t>(i);
+            for (int j = 0; j < order.cols; j++) {
+                if (row[j] < count)
+                    seams[row[j]][vertical ? i : j] = vertical ? j : i;
+            }
+        }
+    }
+
+    /**
+     * @brief Carves like seam::carve() with the seams of the cache. If they don't cover the request, the image is
+     * carved and its seams replace the ones of the cache.
+     *
+     * @details The horizontal seams of the cache run through the image without all cached vertical seams, so they
+     * serve requests for exactly that many columns. Without rows every request for fewer columns is served.
+     */
+    void carveCached(Batch& batch, const cv::Mat& image, int colsToRemove, int rowsToRemove, cv::Mat& output)
+    {
+        const seam::EnergyFunction function = batch.options.function;
+        const seam::SeamCacheKey key = seam::SeamCache::key(image, function);
+        std::vector<std::vector<int>> verticalSeams, horizontalSeams;
+        const size_t cols = static_cast<size_t>(colsToRemove), rows = static_cast<size_t>(rowsToRemove);
+        const bool hit = batch.cache->load(key, verticalSeams, horizontalSeams) &&
+                         (rows == 0 ? verticalSeams.size() >= cols
+                                    : verticalSeams.size() == cols && horizontalSeams.size() >= rows);
+
+        /* a miss carves only the requested seams, recording which pixels they removed */
+        cv::Mat order;
+        if (hit) {
+            SEAM_COUNT("cache_hits", 1);
+        } else {
+            seam::removalOrderVertical(image, order, colsToRemove, function);
+            orderSeams(order, colsToRemove, true, verticalSeams);
+        }
+        verticalSeams.resize(cols);
+        if (rows == 0) {
+            seam::deleteSeamsVertical(image, output, verticalSeams);
+            horizontalSeams.clear();
+        } else {
+            cv::Mat narrow;
+            seam::deleteSeamsVertical(image, narrow, verticalSeams);
+            if (!hit) {
+                seam::removalOrderHorizontal(narrow, order, rowsToRemove, function);
+                orderSeams(order, rowsToRemove, false, horizontalSeams);
+            }
+            horizontalSeams.resize(rows);
+            seam::deleteSeamsHorizontal(narrow, output, horizontalSeams);
+        }
+        if (!hit && !batch.cache->store(key, verticalSeams, horizontalSeams))
+            batch.warning("can't write " + batch.cache->path(key));
+    }
+
+    bool carveJob(Batch& batch, Job& job)
+    {
+        SEAM_SCOPED_TIMER("batch.carve");
+        const seam::BatchOptions& options = batch.options;
+        const cv::Mat& image = job.image;
+        int colsToRemove = options.cols >= 0 ? options.cols : options.width >= 0 ? image.cols - options.width : 0;
+        int rowsToRemove = options.rows >= 0 ? options.rows : options.height >= 0 ? image.rows - options.height : 0;
+        if (colsToRemove < 0 || colsToRemove > image.cols - 3 || rowsToRemove < 0 || rowsToRemove > image.rows - 3) {
+            batch.error("can't carve " + job.path + " (" + std::to_string(image.cols) + "x" +
+                        std::to_string(image.rows) + ") by " + std::to_string(colsToRemove) + " columns and " +
+                        std::to_string(rowsToRemove) + " rows");
+            return false;
+        }
+
+        /* a mapped output file, which the seam deletion writes into, unless it is the mapped input. If the carve
+         * fails, dropping the job removes the file again. */
+        cv::Mat carvedImage;
+        const int type = image.type();
+        const std::string path = outputPath(batch, job);
+        if (batch.options.mappedFiles && seam::isPnmPath(path) &&
+            (type == CV_8UC1 || type == CV_8UC3 || type == CV_16UC1 || type == CV_16UC3) &&
+            !(job.mappedInput && job.mappedInput->isFile(path))) {
+            job.mappedOutput.reset(new seam::MappedImage());
+            if (job.mappedOutput->create(path, cv::Size(image.cols - colsToRemove, image.rows - rowsToRemove), type))
+                carvedImage = job.mappedOutput->image();
+            else
+                job.mappedOutput.reset();
+        }
+
+        /* the removal orders, which record the seams, only fit images below REMOVAL_ORDER_KEPT pixels per side */
+        if (batch.cache && image.rows < seam::REMOVAL_ORDER_KEPT && image.cols < seam::REMOVAL_ORDER_KEPT) {
+            /* the seams of an image, which was carved before, are read, so only their deletion is left */
+            carveCached(batch, image, colsToRemove, rowsToRemove, carvedImage);
+        } else if (options.optimalOrder) {
+            seam::carveOptimal(image, carvedImage, colsToRemove, rowsToRemove, options.function);
+        } else {
+            seam::carve(image, carvedImage, colsToRemove, rowsToRemove, options.function);
+        }
+        if (job.mappedOutput) {
+            /* the optimal order returns an image of its own */
+            cv::Mat& mapped = job.mappedOutput->image();
+            CV_Assert(carvedImage.size() == mapped.size());
+            if (carvedImage.data != mapped.data)
+                carvedImage.copyTo(mapped);
+            carvedImage = mapped;
+        }
+        job.image = carvedImage;
+        job.mappedInput.reset();
+        return true;
+    }
+
+    bool encodeJob(Batch& batch, Job& job)
+    {
+        SEAM_SCOPED_TIMER("batch.encode");
+        const std::string path = outputPath(batch, job);
+        /* the seams were deleted straight into a mapped file, which only has to be converted to its layout */
+        const bool written = job.mappedOutput ? job.mappedOutput->close() : cv::imwrite(path, job.image);
+        if (!written) {
+            batch.error("can't write " + path);
+            return false;
+        }
+        batch.report(job.path + " -> " + path + " (" + std::to_string(job.image.cols) + "x" +
+                     std::to_string(job.image.rows) + ")");
+        return true;
+    }
+
+    /**
+     * @brief Starts the workers of one stage. They take jobs from input, process them and pass the successful
+     * ones on to output. The last worker to finish closes output.
+     * @param output - the queue of the next stage, nullptr for the last stage.
+     */
+    template <typename Work>
+    void startStage(Batch& batch, int workers, JobQueue& input, JobQueue* output, Work work,
+                    std::vector<std::thread>& threads)
+    {
+        std::shared_ptr<std::atomic<int>> running = std::make_shared<std::atomic<int>>(workers);
+        for (int w = 0; w < workers; w++) {
+            threads.emplace_back([&batch, &input, output, work, running] {
+                Job job;
+                while (input.pop(job)) {
+                    bool success = false;
+                    try {
+                        success = work(batch, job);
+                    } catch (const std::exception& exception) {
+                        /* cv::Exception and e.g. std::bad_alloc of a huge image fail only this job */
+                        batch.error(job.path + ": " + exception.what());
+                    }
+                    if (success && output)
+                        output->push(std::move(job));
+                    job = Job();
+                }
+                if (--*running == 0 && output)
+                    output->close();
+            });
+        }
+    }
+} // namespace
+
+int seam::carveBatch(const std::vector<std::string>& paths, const BatchOptions& options)
+{
+    Batch batch(options);
+    int carveWorkers = options.carveWorkers > 0 ? options.carveWorkers
+                                                : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    size_t capacity = static_cast<size_t>(std::max(1, options.queueCapacity));
+
+    JobQueue pathQueue(capacity), decodedQueue(capacity), carvedQueue(capacity);
+    std::vector<std::thread> threads;
+    startStage(batch, std::max(1, options.decodeWorkers), pathQueue, &decodedQueue, decodeJob, threads);
+    startStage(batch, carveWorkers, decodedQueue, &carvedQueue, carveJob, threads);
+    startStage(batch, std::max(1, options.encodeWorkers), carvedQueue, nullptr, encodeJob, threads);
+
+    for (const std::string& path : paths) {
+        Job job;
+        job.path = path;
+        pathQueue.push(std::move(job));
+    }
+    pathQueue.close();
+
+    for (std::thread& thread : threads)
+        thread.join();
+    return batch.failed;
+}
@@ -0,0 +1,71 @@
+#ifndef BATCHCARVER_HPP
+#define BATCHCARVER_HPP
+
+#include <string>
+#include <vector>
+
+#include "SeamFunctions.hpp"
+
+namespace seam {
+    /**
+     * @brief Settings of a batch run. Negative sizes and seam counts are unset.
+     */
+    struct BatchOptions {
+        int width = -1;
+        int height = -1;
+        int cols = -1;
+        int rows = -1;
+        EnergyFunction function = ENERGY_SOBEL;
+        std::string outputDirectory;
+
+        /** Worker threads of the decode, carve and encode stages. 0 uses one carve worker per core. */
+        int decodeWorkers = 1;
+        int carveWorkers = 0;
+        int encodeWorkers = 1;
+
+        /** Maximum number of images waiting between two stages. */
+        int queueCapacity = 4;
+
+        /** Directory of a SeamCache, empty for none. With a cache the seams of an image are computed only once. */
+        std::string cacheDirectory;
+
+        /** Carve in the order of vertical and horizontal seams with the lowest energy, see carveOptimal(). */
+        bool optimalOrder = false;
+
+        /** Map binary PGM and PPM files into memory instead of decoding and encoding them, see MappedImage. */
+        bool mappedFiles = false;
+
+        /** Videos: columns or rows on either side of a seam of the previous frame, in which the seams are searched. */
+        int corridor = 4;
+
+        /** Videos: every keyframeInterval frames the seams are searched in the full frame, 0 for the first only. */
+        int keyframeInterval = 0;
+
+        /** Videos: four character code of the output codec, empty for the one of the input. */
+        std::string fourcc;
+
+        /** Streaming: rows of the bands, in which an image is read, carved and written, see carveStream(). */
+        int bandRows = 512;
+    };
+
+    /**
+     * @brief Carves all images into the output directory with a pipeline of decode, carve and encode stages.
+     * @param paths - the input images.
+     * @param options
+     * @return the number of images which could not be carved.
+     *
+     * @details Every stage is served by its own pool of worker threads and passes the images on through a
+     * bounded queue, so reading and writing files overlaps with carving and at most a few decoded images
+     * per stage are held in memory. The energy, seam search and seam deletion of an image run together in
+     * the carve stage, because iterative carving interleaves them for every seam.
+     * With a cache directory, the seams carved from an image are stored, and every later run with the same
+     * image, energy function and size, or fewer columns only, just deletes them. The result equals carving.
+     * Otherwise the optimal order of both directions can be used.
+     * With mapped files, PGM and PPM inputs are used in place, and the carve stage creates a mapped PGM or PPM
+     * output of the carved size, which the seam deletion writes into, so the encode stage only flushes it.
+     * Progress and errors are reported on stdout and stderr.
+     */
+    int carveBatch(const std::vector<std::string>& paths, const BatchOptions& options);
+} // namespace seam
+
+#endif // BATCHCARVER_HPP
@@ -0,0 +1,79 @@
+#ifndef BOUNDEDQUEUE_HPP
+#define BOUNDEDQUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace seam {
+    /**
+     * @brief Thread-safe FIFO queue with a fixed capacity, connecting two stages of a pipeline.
+     *
+     * @details push() blocks while the queue is full, so a fast producer can't run ahead of a slow consumer
+     * and the memory held by queued items stays bounded. Once all producers are done, close() lets the
+     * consumers drain the remaining items, after which pop() returns false.
+     */
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(std::size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        /**
+         * @brief Appends an item, waiting until there is space.
+         * @return false if the queue was closed, the item is dropped then.
+         */
+        bool push(T item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+            if (closed)
+                return false;
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        /**
+         * @brief Takes the oldest item, waiting until there is one.
+         * @return false if the queue is closed and empty.
+         */
+        bool pop(T& item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+            if (items.empty())
+                return false;
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        /**
+         * @brief Wakes all waiting threads. Items already queued can still be popped.
+         */
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+
+    private:
+        const std::size_t capacity;
+        bool closed;
+        std::deque<T> items;
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+    };
+} // namespace seam
+
+#endif // BOUNDEDQUEUE_HPP
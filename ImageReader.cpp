@@ -2,5 +2,31 @@
 
 cv::Mat ImageReader::readImage(const std::string& filePath)
 {
-    return cv::imread(filePath);
+    /* keep the depth, e.g. of 16 bit scans, the seam functions work on every type. Unlike IMREAD_UNCHANGED
+     * these flags apply the EXIF orientation like readMask(), so a mask lines up with its image. */
+    return cv::imread(filePath, cv::IMREAD_ANYDEPTH | cv::IMREAD_ANYCOLOR);
+}
+
+cv::Mat ImageReader::readMask(const std::string& filePath)
+{
+    /* 8 bit BGR in the EXIF orientation, like readImage() */
+    cv::Mat image = cv::imread(filePath, cv::IMREAD_COLOR);
+    if (image.empty())
+        return image;
+
+    cv::Mat mask(image.rows, image.cols, CV_8UC1);
+    for (int i = 0; i < image.rows; i++) {
+        const cv::Vec3b* row = image.ptr<cv::Vec3b>(i);
+        uchar* maskRow = mask.ptr<uchar>(i);
+        for (int j = 0; j < image.cols; j++) {
+            /* channels are in BGR order */
+            if (row[j][1] > 127 && row[j][2] <= 127)
+                maskRow[j] = seam::MASK_PROTECT;
+            else if (row[j][2] > 127 && row[j][1] <= 127)
+                maskRow[j] = seam::MASK_REMOVE;
+            else
+                maskRow[j] = seam::MASK_NONE;
+        }
+    }
+    return mask;
 }
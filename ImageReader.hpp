@@ -4,13 +4,26 @@
 #include <iostream>
 #include <string>
 #include "opencv2/core.hpp"
-#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+#include "SeamFunctions.hpp"
 
 class ImageReader
 {
 public:
     
+    /**
+     * @brief Reads an image in its own depth, e.g. 16 bit, as grayscale or BGR in its EXIF orientation.
+     * @param filePath
+     * @return the image, empty if it can't be read.
+     */
     static cv::Mat readImage(const std::string& filePath);
+
+    /**
+     * @brief Reads a mask for the seams. Green pixels are protected, red pixels are removed first.
+     * @param filePath
+     * @return CV_8UC1 image with seam::MaskValue entries, empty if the image can't be read.
+     */
+    static cv::Mat readMask(const std::string& filePath);
 };
 
 #endif // IMAGEREADER_HPP
@@ -0,0 +1,136 @@
+#include "Instrumentation.hpp"
+
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+    /* Registered timers and counters, as singly linked lists in reverse order of registration. */
+    std::mutex registryMutex;
+    seam::instrumentation::Timer* timers = nullptr;
+    seam::instrumentation::Counter* counters = nullptr;
+
+    struct TimerTotal {
+        std::string name;
+        int64_t nanoseconds;
+        int64_t calls;
+    };
+
+    struct CounterTotal {
+        std::string name;
+        int64_t value;
+    };
+
+    /**
+     * @brief Sums up the timers and counters by name, in order of registration.
+     */
+    void collect(std::vector<TimerTotal>& timerTotals, std::vector<CounterTotal>& counterTotals)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (seam::instrumentation::Timer* timer = timers; timer; timer = timer->next) {
+            TimerTotal* total = nullptr;
+            for (TimerTotal& candidate : timerTotals)
+                if (candidate.name == timer->name)
+                    total = &candidate;
+            if (!total) {
+                timerTotals.insert(timerTotals.begin(), TimerTotal{timer->name, 0, 0});
+                total = &timerTotals.front();
+            }
+            total->nanoseconds += timer->total;
+            total->calls += timer->calls;
+        }
+        for (seam::instrumentation::Counter* counter = counters; counter; counter = counter->next) {
+            CounterTotal* total = nullptr;
+            for (CounterTotal& candidate : counterTotals)
+                if (candidate.name == counter->name)
+                    total = &candidate;
+            if (!total) {
+                counterTotals.insert(counterTotals.begin(), CounterTotal{counter->name, 0});
+                total = &counterTotals.front();
+            }
+            total->value += counter->total;
+        }
+    }
+
+    double milliseconds(int64_t nanoseconds)
+    {
+        return static_cast<double>(nanoseconds) / 1e6;
+    }
+} // namespace
+
+seam::instrumentation::Timer::Timer(const char* name) : name(name), total(0), calls(0)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    next = timers;
+    timers = this;
+}
+
+seam::instrumentation::Counter::Counter(const char* name) : name(name), total(0)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    next = counters;
+    counters = this;
+}
+
+bool seam::instrumentation::enabled()
+{
+#ifdef SEAM_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+void seam::instrumentation::reset()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (Timer* timer = timers; timer; timer = timer->next) {
+        timer->total = 0;
+        timer->calls = 0;
+    }
+    for (Counter* counter = counters; counter; counter = counter->next)
+        counter->total = 0;
+}
+
+void seam::instrumentation::report(std::ostream& stream)
+{
+    if (!enabled()) {
+        stream << "instrumentation disabled, build with CONFIG+=instrumentation\n";
+        return;
+    }
+
+    std::vector<TimerTotal> timerTotals;
+    std::vector<CounterTotal> counterTotals;
+    collect(timerTotals, counterTotals);
+
+    stream << std::left << std::setw(32) << "timer" << std::right << std::setw(14) << "total ms"
+           << std::setw(10) << "calls" << std::setw(14) << "avg ms" << "\n";
+    for (const TimerTotal& total : timerTotals) {
+        stream << std::left << std::setw(32) << total.name << std::right << std::fixed << std::setprecision(3)
+               << std::setw(14) << milliseconds(total.nanoseconds) << std::setw(10) << total.calls
+               << std::setw(14) << (total.calls > 0 ? milliseconds(total.nanoseconds) / total.calls : 0.0) << "\n";
+    }
+    stream << std::left << std::setw(32) << "counter" << std::right << std::setw(14) << "value" << "\n";
+    for (const CounterTotal& total : counterTotals)
+        stream << std::left << std::setw(32) << total.name << std::right << std::setw(14) << total.value << "\n";
+}
+
+void seam::instrumentation::reportJson(std::ostream& stream)
+{
+    std::vector<TimerTotal> timerTotals;
+    std::vector<CounterTotal> counterTotals;
+    collect(timerTotals, counterTotals);
+
+    /* the names are string literals without characters that need escaping */
+    stream << std::setprecision(9) << "{\n  \"enabled\": " << (enabled() ? "true" : "false") << ",\n  \"timers\": {";
+    for (size_t t = 0; t < timerTotals.size(); t++) {
+        stream << (t == 0 ? "\n" : ",\n") << "    \"" << timerTotals[t].name << "\": {\"total_ms\": "
+               << milliseconds(timerTotals[t].nanoseconds) << ", \"calls\": " << timerTotals[t].calls << "}";
+    }
+    stream << "\n  },\n  \"counters\": {";
+    for (size_t c = 0; c < counterTotals.size(); c++) {
+        stream << (c == 0 ? "\n" : ",\n") << "    \"" << counterTotals[c].name << "\": " << counterTotals[c].value;
+    }
+    stream << "\n  }\n}\n";
+}
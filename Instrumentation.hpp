@@ -0,0 +1,118 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Lightweight timers and counters for profiling carving runs without an external profiler.
+ *
+ * The macros compile to nothing unless SEAM_INSTRUMENTATION is defined, which the .pro files do for
+ * "qmake CONFIG+=instrumentation". Every timer and counter is a static object at its call site which
+ * registers itself once, so recording is a clock read and an atomic add. Timers and counters with the same
+ * name are summed up in the report.
+ *
+ *     SEAM_SCOPED_TIMER("energy");          measures until the end of the enclosing scope
+ *     SEAM_COUNT("seams_computed", 1);      adds to a counter
+ */
+#ifdef SEAM_INSTRUMENTATION
+#define SEAM_INSTRUMENTATION_CONCAT_(a, b) a##b
+#define SEAM_INSTRUMENTATION_CONCAT(a, b) SEAM_INSTRUMENTATION_CONCAT_(a, b)
+#define SEAM_SCOPED_TIMER(name) \
+    static seam::instrumentation::Timer SEAM_INSTRUMENTATION_CONCAT(seamTimer, __LINE__)(name); \
+    seam::instrumentation::ScopedTimer SEAM_INSTRUMENTATION_CONCAT(seamScopedTimer, __LINE__)( \
+        SEAM_INSTRUMENTATION_CONCAT(seamTimer, __LINE__))
+#define SEAM_COUNT(name, value) \
+    do { \
+        static seam::instrumentation::Counter seamCounter(name); \
+        seamCounter.add(static_cast<int64_t>(value)); \
+    } while (false)
+#else
+#define SEAM_SCOPED_TIMER(name) ((void)0)
+#define SEAM_COUNT(name, value) ((void)0)
+#endif
+
+namespace seam {
+namespace instrumentation {
+    /**
+     * @brief Total time and number of calls of one timed scope.
+     */
+    class Timer
+    {
+    public:
+        explicit Timer(const char* name);
+
+        void add(int64_t nanoseconds)
+        {
+            total.fetch_add(nanoseconds, std::memory_order_relaxed);
+            calls.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const char* const name;
+        std::atomic<int64_t> total;
+        std::atomic<int64_t> calls;
+        Timer* next;
+    };
+
+    /**
+     * @brief Adds the time from construction to destruction to a timer.
+     */
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(Timer& timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+
+        ~ScopedTimer()
+        {
+            timer.add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start).count());
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Timer& timer;
+        const std::chrono::steady_clock::time_point start;
+    };
+
+    /**
+     * @brief Sum of the values of one counter.
+     */
+    class Counter
+    {
+    public:
+        explicit Counter(const char* name);
+
+        void add(int64_t value) { total.fetch_add(value, std::memory_order_relaxed); }
+
+        const char* const name;
+        std::atomic<int64_t> total;
+        Counter* next;
+    };
+
+    /**
+     * @brief Whether the instrumentation was compiled in.
+     */
+    bool enabled();
+
+    /**
+     * @brief Sets all timers and counters to zero, e.g. at the start of a run.
+     */
+    void reset();
+
+    /**
+     * @brief Writes a table with the total and average time of every timer and the value of every counter.
+     */
+    void report(std::ostream& stream);
+
+    /**
+     * @brief Writes the same values as report() as a JSON object, times in milliseconds.
+     */
+    void reportJson(std::ostream& stream);
+} // namespace instrumentation
+} // namespace seam
+
+#endif // INSTRUMENTATION_HPP
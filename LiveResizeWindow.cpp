@@ -0,0 +1,139 @@
+#include "LiveResizeWindow.hpp"
+#include "Instrumentation.hpp"
+
+#include <algorithm>
+
+#include <QPainter>
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+namespace
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    const QImage::Format BUFFER_FORMAT = QImage::Format_BGR888;
+#else
+    const QImage::Format BUFFER_FORMAT = QImage::Format_RGB888;
+#endif
+
+    /**
+     * @brief Converts an image of any depth with 1, 3 or 4 channels to 8 bit with the channels of BUFFER_FORMAT.
+     */
+    cv::Mat displayImage(const cv::Mat& image)
+    {
+        /* 16 bit and floating point images are scaled like for the energy, see seam::grayscale() */
+        cv::Mat image8 = image;
+        if (image.depth() == CV_16U) {
+            image.convertTo(image8, CV_8U, 255.0 / 65535.0);
+        } else if (image.depth() == CV_32F || image.depth() == CV_64F) {
+            double maxValue = 0;
+            cv::minMaxLoc(image.reshape(1), nullptr, &maxValue);
+            image.convertTo(image8, CV_8U, 255.0 / std::max(maxValue, 1.0));
+        }
+
+        cv::Mat result;
+        switch (image8.channels()) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        case 1:
+            cv::cvtColor(image8, result, cv::COLOR_GRAY2BGR);
+            break;
+        case 4:
+            cv::cvtColor(image8, result, cv::COLOR_BGRA2BGR);
+            break;
+        default:
+            result = image8;
+#else
+        case 1:
+            cv::cvtColor(image8, result, cv::COLOR_GRAY2RGB);
+            break;
+        case 4:
+            cv::cvtColor(image8, result, cv::COLOR_BGRA2RGB);
+            break;
+        default:
+            cv::cvtColor(image8, result, cv::COLOR_BGR2RGB);
+#endif
+        }
+        return result;
+    }
+} // namespace
+
+LiveResizeWindow::LiveResizeWindow(QWidget *parent) :
+    QWidget(parent)
+{
+    setWindowTitle(QString("Live Resize"));
+    verticalLayout = new QVBoxLayout(this);
+
+    /* the image area, its size is the largest size of the image when the window edge is dragged */
+    view = new QWidget(this);
+    view->setMinimumSize(QSize(1, 1));
+    view->installEventFilter(this);
+    verticalLayout->addWidget(view, 1);
+
+    horizontalLayout = new QHBoxLayout();
+    sWidth = new QSlider(Qt::Horizontal, this);
+    horizontalLayout->addWidget(sWidth);
+    sHeight = new QSlider(Qt::Horizontal, this);
+    horizontalLayout->addWidget(sHeight);
+    lSize = new QLabel(this);
+    horizontalLayout->addWidget(lSize);
+    verticalLayout->addLayout(horizontalLayout);
+
+    connect(sWidth,  &QSlider::valueChanged, this, &LiveResizeWindow::on_sSize_valueChanged);
+    connect(sHeight, &QSlider::valueChanged, this, &LiveResizeWindow::on_sSize_valueChanged);
+}
+
+void LiveResizeWindow::setSeamMap(const seam::SeamMap& map)
+{
+    CV_Assert(!map.empty());
+    seamMap = map;
+    /* the original image is only needed to convert it, the map gets its own display image */
+    cv::Mat display = displayImage(seamMap.input());
+    seamMap.setImage(display);
+
+    /* the buffer is allocated once with the full size, every frame uses its top left part */
+    buffer = QImage(display.cols, display.rows, BUFFER_FORMAT);
+    frame = cv::Mat(display.rows, display.cols, CV_8UC3, buffer.bits(), static_cast<size_t>(buffer.bytesPerLine()));
+
+    sWidth->setRange(seamMap.minWidth(), display.cols);
+    sHeight->setRange(seamMap.minHeight(), display.rows);
+    sWidth->setValue(display.cols);
+    sHeight->setValue(display.rows);
+    resize(display.cols, display.rows + sWidth->height());
+    view->update();
+}
+
+bool LiveResizeWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched != view || seamMap.empty())
+        return QWidget::eventFilter(watched, event);
+    switch (event->type()) {
+    case QEvent::Resize:
+        /* dragging the window edge retargets the image to the new image area */
+        sWidth->setValue(std::min(view->width(), frame.cols));
+        sHeight->setValue(std::min(view->height(), frame.rows));
+        return false;
+    case QEvent::Paint:
+        render();
+        return true;
+    default:
+        return QWidget::eventFilter(watched, event);
+    }
+}
+
+void LiveResizeWindow::on_sSize_valueChanged()
+{
+    lSize->setText(QString("%1 x %2").arg(sWidth->value()).arg(sHeight->value()));
+    /* repaints are merged, so the image is only retargeted for the last size before the next frame */
+    view->update();
+}
+
+void LiveResizeWindow::render()
+{
+    SEAM_SCOPED_TIMER("gui.liveResize");
+    const int width = sWidth->value(), height = sHeight->value();
+    /* a header of the buffer, retarget() keeps its memory */
+    cv::Mat output = frame(cv::Rect(0, 0, width, height));
+    seamMap.retarget(width, height, output, context);
+
+    QPainter painter(view);
+    painter.drawImage(QPoint(0, 0), buffer, QRect(0, 0, width, height));
+}
@@ -0,0 +1,61 @@
+#ifndef LIVERESIZEWINDOW_HPP
+#define LIVERESIZEWINDOW_HPP
+
+#include <QBoxLayout>
+#include <QEvent>
+#include <QImage>
+#include <QLabel>
+#include <QSlider>
+#include <QWidget>
+
+#include "opencv2/core/core.hpp"
+#include "SeamMap.hpp"
+
+/**
+ * @brief Shows the image of a seam map, which is retargeted while the sliders or the window edge are dragged.
+ *
+ * @details The image is converted once to 8 bit BGR, or RGB before Qt 5.14, and keeps the removal order of
+ * the map. Every frame is retargeted straight into a QImage of the full size, whose top left part is drawn.
+ * Neither the QImage nor the working memory of the retarget are allocated again. A new size only schedules a
+ * repaint, so a frame is computed at most once per repaint, however fast the sliders move.
+ */
+class LiveResizeWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LiveResizeWindow(QWidget *parent = 0);
+
+    /**
+     * @brief Shows the image of map at its full size.
+     * @param map - a computed seam map, the window keeps its own copy.
+     */
+    void setSeamMap(const seam::SeamMap& map);
+
+protected:
+    /* paints and follows the size of the image area */
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void on_sSize_valueChanged();
+
+private:
+    /* Retargets the image to the size of the sliders and draws it. */
+    void render();
+
+    QVBoxLayout *verticalLayout;
+    QHBoxLayout *horizontalLayout;
+    QWidget     *view;
+    QLabel      *lSize;
+    QSlider     *sWidth;
+    QSlider     *sHeight;
+
+    /* seam map of the displayed image */
+    seam::SeamMap seamMap;
+    seam::SeamMap::RetargetContext context;
+    /* the retargeted image, in the top left corner of the full size buffer */
+    QImage buffer;
+    cv::Mat frame;
+};
+
+#endif // LIVERESIZEWINDOW_HPP
@@ -1,8 +1,34 @@
 #include "MainWindow.hpp"
 #include <string>
 
+namespace {
+    /**
+     * @brief Converts an image to a depth, which the format of the file can store.
+     * @details JPEG only stores 8 bit, PNG also 16 bit and TIFF every depth. Like for the energy, see
+     * seam::grayscale(), 16 bit is scaled to its full range and floating point to its maximum.
+     */
+    cv::Mat savableImage(const cv::Mat& image, const QString& fileName)
+    {
+        const QString suffix = QFileInfo(fileName).suffix().toLower();
+        const bool floatingPoint = image.depth() == CV_32F || image.depth() == CV_64F;
+        const bool only8Bit = suffix == "jpg" || suffix == "jpeg";
+        if (suffix == "tif" || suffix == "tiff" || image.depth() == CV_8U || (!only8Bit && !floatingPoint))
+            return image;
+
+        cv::Mat image8;
+        if (floatingPoint) {
+            double maxValue = 0;
+            cv::minMaxLoc(image.reshape(1), nullptr, &maxValue);
+            image.convertTo(image8, CV_8U, 255.0 / std::max(maxValue, 1.0));
+        } else {
+            image.convertTo(image8, CV_8U, 255.0 / 65535.0);
+        }
+        return image8;
+    }
+} // namespace
+
 MainWindow::MainWindow(QWidget *parent) :
-    QMainWindow(parent)
+    QMainWindow(parent), retargetWhenMapped(false), liveResizeWhenMapped(false)
 {
     /* Initialisiere die UI Komponenten */
     setupUi();
@@ -12,14 +38,20 @@ MainWindow::~MainWindow()
 {
     /* loesche die UI Komponenten */
     delete centralWidget;    
+    delete liveResizeWindow;
     
     /* schliesse alle offenen Fenster */
     cv::destroyAllWindows();
+
+    /* report the timers and counters of the session, if they were compiled in */
+    if (seam::instrumentation::enabled())
+        seam::instrumentation::report(std::clog);
 }
 
 /* Methode oeffnet ein Bild und zeigt es in einem separaten Fenster an */
 void MainWindow::on_pbOpenImage_clicked()
 {
+    SEAM_SCOPED_TIMER("gui.openImage");
     /* oeffne Bild mit Hilfe eines Dateidialogs */
     QString imagePath = QFileDialog::getOpenFileName(this, "Open Image...", QString(), QString("Images *.png *.jpg *.tiff *.tif"));
     
@@ -34,6 +66,8 @@ void MainWindow::on_pbOpenImage_clicked()
         {
             /* ...merke das Originalbild... */
             originalImage = img;
+            maskImage.release();
+            seamMap.clear();
             
             /* ...aktiviere das UI... */
             enableGUI();
@@ -49,6 +83,23 @@ void MainWindow::on_pbOpenImage_clicked()
     }
 }
 
+void MainWindow::on_pbOpenMask_clicked()
+{
+    SEAM_SCOPED_TIMER("gui.openMask");
+    QString maskPath = QFileDialog::getOpenFileName(this, "Open Mask...", QString(), QString("Images *.png *.jpg *.tiff *.tif"));
+    if (maskPath.isNull() || maskPath.isEmpty())
+        return;
+
+    /* green pixels are protected, red pixels are removed */
+    cv::Mat mask = ImageReader::readMask(QtOpencvCore::qstr2str(maskPath));
+    if (mask.size() != originalImage.size()) {
+        maskSizeError();
+        return;
+    }
+    maskImage = mask;
+    seamMap.clear();
+}
+
 void MainWindow::on_pbComputeSeams_clicked()
 {
     /* reset seams */
@@ -61,54 +112,45 @@ void MainWindow::on_pbComputeSeams_clicked()
     /* Anzahl der Zeilen, die entfernt werden sollen */
     int rowsToRemove = sbRows->value();
     
-    /* Compute energy function. */
-    cv::Mat grayscaleImage;
-    cv::cvtColor(originalImage, grayscaleImage, cv::COLOR_BGR2GRAY);
-    cv::Mat gradientImage;
-    seam::sobel(grayscaleImage, gradientImage);
-    grayscaleImage.release();
-
-    cv::Mat gradientImageCopy = gradientImage.clone(); /* Only needed for visualization. @todo: delete */
-    /* In the beginning, all pixel are not blocked. Matrix has two extra columns for the borders. */
-    std::vector<std::vector<bool>> blockedPixels(gradientImage.rows, std::vector<bool>(gradientImage.cols + 2, false));
-
-    /* Compute vertical seams and store them. */
-    for (int i = 0; i < colsToRemove; i++) {
-        std::vector<int> seam = seam::seamVertical(gradientImage, blockedPixels);
-        if (seam.size() != 0)
-            seamsVertical.emplace_back(seam);
-        else {
-            seamsVerticalBlockError(i);
-            break;
-        }
+    /* Energy function */
+    seam::EnergyFunction energyFunction = static_cast<seam::EnergyFunction>(cbEnergy->currentIndex());
+
+    /* The worker shares the pixels of the images, it never modifies them. */
+    SeamWorker::Job job;
+    job.image = originalImage;
+    job.mask = maskImage;
+    job.function = energyFunction;
 
+    /* Compute the removal order of all seams once, after that every size is a single pass over the pixels. */
+    if (cbSeamMap->isChecked()) {
+        if (!seamMap.empty() && seamMap.energyFunction() == energyFunction) {
+            retargetSeamMap();
+            return;
+        }
+        job.task = SeamWorker::SEAM_MAP;
+        retargetWhenMapped = true;
     }
-    cv::imshow("vertical", gradientImage);
-
-    /* Reset blocked pixels. In the beginning, all pixel are not blocked. Matrix has two extra rows
-     * for the borders. */
-    for (auto& row : blockedPixels) {
-        std::fill(row.begin(), row.end(), 0);
-        row.pop_back();
-        row.pop_back();
+    /* Find the order of vertical and horizontal seams with the lowest energy, then remove them one at a time. */
+    else if (cbOptimalOrder->isChecked()) {
+        job.task = SeamWorker::CARVE_OPTIMAL;
+        job.colsToRemove = std::min(colsToRemove, originalImage.cols - 3);
+        job.rowsToRemove = std::min(rowsToRemove, originalImage.rows - 3);
     }
-    blockedPixels.emplace_back(std::vector<bool>(gradientImage.cols, false));
-    blockedPixels.emplace_back(std::vector<bool>(gradientImage.cols, false));
-
-    /* Compute horizontal seams and store them. */
-    for (int i = 0; i < rowsToRemove; i++) {
-        std::vector<int> seam = seam::seamHorizontal(gradientImageCopy, blockedPixels);
-        if (seam.size() != 0)
-            seamsHorizontal.emplace_back(seam);
-        else {
-            seamsHorizontalBlockError(i);
-            break;
-        }
+    /* Remove the seams one at a time and update the energy after each of them. */
+    else if (cbIterative->isChecked()) {
+        job.task = SeamWorker::CARVE_ITERATIVE;
+        job.colsToRemove = std::min(colsToRemove, originalImage.cols - 3);
+        job.rowsToRemove = std::min(rowsToRemove, originalImage.rows - 3);
     }
-    cv::imshow("horizontal", gradientImageCopy);
-
-    gradientImage.release();
-    gradientImageCopy.release();
+    /* Compute all seams of a direction on the same energy, they are removed or inserted later. */
+    else {
+        job.task = SeamWorker::COMPUTE_SEAMS;
+        job.colsToRemove = colsToRemove;
+        job.rowsToRemove = rowsToRemove;
+        /* The pyramid search only refines the seams of a smaller image, which is much faster for large images. */
+        job.pyramidSearch = cbPyramid->isChecked();
+    }
+    startJob(std::move(job));
 }
 
 void MainWindow::on_pbRemoveSeams_clicked()
@@ -119,42 +161,165 @@ void MainWindow::on_pbRemoveSeams_clicked()
         return;
     }
 
-	std::sort(seamsVertical.begin(), seamsVertical.end(),
-              [](const std::vector<int>& a, const std::vector<int>& b) {
-        return a[0] < b[0];
-    });
-    cv::Mat verticalDeletedImage;
-    /* Remove all vertical seams that were computed earlier in ascending order. */
-    seam::deleteSeamsVertical(originalImage, verticalDeletedImage, seamsVertical);
+    /* Remove all vertical and horizontal seams that were computed earlier in one pass. */
+    SeamWorker::Job job;
+    job.task = SeamWorker::REMOVE_SEAMS;
+    job.image = originalImage;
+    job.seamsVertical.swap(seamsVertical);
+    job.seamsHorizontal.swap(seamsHorizontal);
+    startJob(std::move(job));
+}
 
-    seam::combineVerticalHorizontalSeams(seamsVertical, seamsHorizontal);
+void MainWindow::on_pbInsertSeams_clicked()
+{
+    /* Check if seams were already computed. */
+    if (seamsHorizontal.size() == 0 && seamsVertical.size() == 0) {
+        noSeamsError();
+        return;
+    }
+
+    /* Duplicate all vertical and horizontal seams that were computed earlier, so the image gets larger. */
+    SeamWorker::Job job;
+    job.task = SeamWorker::INSERT_SEAMS;
+    job.image = originalImage;
+    job.seamsVertical.swap(seamsVertical);
+    job.seamsHorizontal.swap(seamsHorizontal);
+    startJob(std::move(job));
+}
 
-    std::sort(seamsHorizontal.begin(), seamsHorizontal.end(),
-              [](const std::vector<int>& a, const std::vector<int>& b) {
-        return a[0] < b[0];
-    });
+void MainWindow::on_pbCancel_clicked()
+{
+    worker.cancel();
+}
+
+void MainWindow::on_pbLiveResize_clicked()
+{
+    seam::EnergyFunction energyFunction = static_cast<seam::EnergyFunction>(cbEnergy->currentIndex());
+    if (!seamMap.empty() && seamMap.energyFunction() == energyFunction) {
+        showLiveResize();
+        return;
+    }
+    /* the window opens when the seam map is computed, which "Compute Seams" may already have started */
+    if (worker.isRunning() && worker.job().task != SeamWorker::SEAM_MAP)
+        return;
+    liveResizeWhenMapped = true;
+    if (!worker.isRunning())
+        startSeamMapJob();
+}
 
-    cv::Mat seamsDeletedImage;
-    /* Remove all horizontal seams that were computed earlier in ascending order and adjusted for the already removed
-       vertical seams. */
-    seam::deleteSeamsHorizontal(verticalDeletedImage, seamsDeletedImage, seamsHorizontal);
+void MainWindow::startSeamMapJob()
+{
+    SeamWorker::Job job;
+    job.task = SeamWorker::SEAM_MAP;
+    job.image = originalImage;
+    job.mask = maskImage;
+    job.function = static_cast<seam::EnergyFunction>(cbEnergy->currentIndex());
+    job.previews = false;
+    startJob(std::move(job));
+}
 
-    cv::imshow("Downscaled Image", seamsDeletedImage);
-    modifiedImage = seamsDeletedImage;
+void MainWindow::showLiveResize()
+{
+    liveResizeWindow->setSeamMap(seamMap);
+    liveResizeWindow->show();
+}
 
-    seamsHorizontal.clear();
-    seamsVertical.clear();
+void MainWindow::startJob(SeamWorker::Job job)
+{
+    if (!worker.start(std::move(job)))
+        return;
+    setBusy(true);
+    /* busy indicator until the first progress */
+    progressBar->setRange(0, 0);
+}
+
+void MainWindow::onWorkerProgress(int done, int total)
+{
+    progressBar->setRange(0, total);
+    progressBar->setValue(done);
+}
+
+void MainWindow::onWorkerPreview(QString title, cv::Mat image)
+{
+    cv::imshow(QtOpencvCore::qstr2str(title), image);
+}
+
+void MainWindow::onWorkerFinished()
+{
+    setBusy(false);
+    progressBar->setRange(0, 1);
+    progressBar->reset();
+
+    /* a cancelled job keeps what it computed so far, except for the incomplete seam map */
+    SeamWorker::Job& job = worker.job();
+    switch (job.task) {
+    case SeamWorker::COMPUTE_SEAMS:
+        seamsVertical.swap(job.seamsVertical);
+        seamsHorizontal.swap(job.seamsHorizontal);
+        cv::imshow("vertical", job.verticalEnergy);
+        cv::imshow("horizontal", job.horizontalEnergy);
+        if (job.verticalBlocked)
+            seamsVerticalBlockError(static_cast<int>(seamsVertical.size()));
+        if (job.horizontalBlocked)
+            seamsHorizontalBlockError(static_cast<int>(seamsHorizontal.size()));
+        break;
+    case SeamWorker::SEAM_MAP:
+        if (!job.cancelled) {
+            seamMap = job.seamMap;
+            if (retargetWhenMapped)
+                retargetSeamMap();
+            if (liveResizeWhenMapped)
+                showLiveResize();
+        }
+        retargetWhenMapped = false;
+        liveResizeWhenMapped = false;
+        break;
+    default:
+        modifiedImage = job.result;
+        cv::imshow(job.task == SeamWorker::INSERT_SEAMS ? "Upscaled Image" : "Downscaled Image", modifiedImage);
+        pbSaveImage->setEnabled(true);
+    }
+    /* release the images of the job */
+    job = SeamWorker::Job();
+}
+
+void MainWindow::on_sbSize_valueChanged()
+{
+    /* only a seam map of the current energy function can be used, and not while it is computed */
+    if (worker.isRunning())
+        return;
+    seam::EnergyFunction energyFunction = static_cast<seam::EnergyFunction>(cbEnergy->currentIndex());
+    if (cbSeamMap->isChecked() && !seamMap.empty() && seamMap.energyFunction() == energyFunction)
+        retargetSeamMap();
+}
+
+void MainWindow::retargetSeamMap()
+{
+    SEAM_SCOPED_TIMER("gui.retarget");
+    int width = std::max(originalImage.cols - sbCols->value(), seamMap.minWidth());
+    int height = std::max(originalImage.rows - sbRows->value(), seamMap.minHeight());
+    seamMap.retarget(width, height, modifiedImage);
+    cv::imshow("Downscaled Image", modifiedImage);
     pbSaveImage->setEnabled(true);
 }
 
 void MainWindow::on_pbSaveImage_clicked()
 {
-    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Image"), "", tr("Images (*.png *.xpm *.jpg)"));
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Image"), "", tr("Images (*.png *.jpg *.tiff *.tif)"));
     if (fileName.isEmpty())
         disableGUI();
     else {
-        QImage image = QtOpencvCore::img2qimg(modifiedImage);
-        image.save(fileName);
+        /* OpenCV keeps the depth of the image, e.g. of 16 bit scans, where the format can store it */
+        bool written = false;
+        QString reason;
+        try {
+            written = cv::imwrite(QtOpencvCore::qstr2str(fileName), savableImage(modifiedImage, fileName));
+        } catch (const std::exception& exception) {
+            /* e.g. cv::Exception for a type, which the encoder doesn't support */
+            reason = QString::fromStdString(exception.what());
+        }
+        if (!written)
+            saveError(fileName, reason);
     }
 }
 
@@ -162,11 +327,11 @@ void MainWindow::setupUi()
 {
     /* Boilerplate code */
     /*********************************************************************************************/
-    resize(129, 211);
+    resize(129, 460);
     QSizePolicy sizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     setSizePolicy(sizePolicy);
-    setMinimumSize(QSize(129, 211));
-    setMaximumSize(QSize(129, 211));
+    setMinimumSize(QSize(129, 460));
+    setMaximumSize(QSize(129, 460));
     centralWidget = new QWidget(this);
     centralWidget->setObjectName(QString("centralWidget"));
     
@@ -176,6 +341,10 @@ void MainWindow::setupUi()
     pbOpenImage = new QPushButton(QString("Open Image"), centralWidget);
     verticalLayout->addWidget(pbOpenImage);
 
+    pbOpenMask = new QPushButton(QString("Open Mask"), centralWidget);
+    pbOpenMask->setEnabled(false);
+    verticalLayout->addWidget(pbOpenMask);
+
     verticalLayout_3 = new QVBoxLayout();
     lCaption = new QLabel(QString("Remove"), centralWidget);
     lCaption->setEnabled(false);
@@ -199,6 +368,30 @@ void MainWindow::setupUi()
     sbRows->setEnabled(false);
     horizontalLayout_2->addWidget(sbRows);
     verticalLayout_3->addLayout(horizontalLayout_2);
+
+    cbIterative = new QCheckBox(QString("Iterative"), centralWidget);
+    cbIterative->setEnabled(false);
+    verticalLayout_3->addWidget(cbIterative);
+
+    cbSeamMap = new QCheckBox(QString("Seam Map"), centralWidget);
+    cbSeamMap->setEnabled(false);
+    verticalLayout_3->addWidget(cbSeamMap);
+
+    cbOptimalOrder = new QCheckBox(QString("Optimal Order"), centralWidget);
+    cbOptimalOrder->setEnabled(false);
+    verticalLayout_3->addWidget(cbOptimalOrder);
+
+    cbPyramid = new QCheckBox(QString("Pyramid Search"), centralWidget);
+    cbPyramid->setEnabled(false);
+    verticalLayout_3->addWidget(cbPyramid);
+
+    /* Same order as seam::EnergyFunction */
+    cbEnergy = new QComboBox(centralWidget);
+    cbEnergy->addItem(QString("Sobel"));
+    cbEnergy->addItem(QString("Scharr"));
+    cbEnergy->addItem(QString("Forward"));
+    cbEnergy->setEnabled(false);
+    verticalLayout_3->addWidget(cbEnergy);
     verticalLayout->addLayout(verticalLayout_3);
     
     pbComputeSeams = new QPushButton(QString("Compute Seams"), centralWidget);
@@ -209,10 +402,27 @@ void MainWindow::setupUi()
     pbRemoveSeams->setEnabled(false);
     verticalLayout->addWidget(pbRemoveSeams);
 
+    pbInsertSeams = new QPushButton(QString("Insert Seams"), centralWidget);
+    pbInsertSeams->setEnabled(false);
+    verticalLayout->addWidget(pbInsertSeams);
+
     pbSaveImage = new QPushButton(QString("Save Image"), centralWidget);
     pbSaveImage->setEnabled(false);
     verticalLayout->addWidget(pbSaveImage);
 
+    pbLiveResize = new QPushButton(QString("Live Resize"), centralWidget);
+    pbLiveResize->setEnabled(false);
+    verticalLayout->addWidget(pbLiveResize);
+
+    progressBar = new QProgressBar(centralWidget);
+    progressBar->setRange(0, 1);
+    progressBar->reset();
+    verticalLayout->addWidget(progressBar);
+
+    pbCancel = new QPushButton(QString("Cancel"), centralWidget);
+    pbCancel->setEnabled(false);
+    verticalLayout->addWidget(pbCancel);
+
     
     verticalSpacer = new QSpacerItem(20, 40, QSizePolicy::Minimum, QSizePolicy::Expanding);
     verticalLayout->addItem(verticalSpacer);
@@ -221,14 +431,28 @@ void MainWindow::setupUi()
     horizontalSpacer = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
     horizontalLayout->addItem(horizontalSpacer);
     setCentralWidget(centralWidget);
+
+    /* a window of its own, which is kept while other images are opened */
+    liveResizeWindow = new LiveResizeWindow();
     /*********************************************************************************************/
     
     
     /* Verbindung zwischen den Buttonklicks und den Methoden, die beim jeweiligen Buttonklick ausgefuehrt werden sollen */
     connect(pbOpenImage,    &QPushButton::clicked, this, &MainWindow::on_pbOpenImage_clicked);  
+    connect(pbOpenMask,     &QPushButton::clicked, this, &MainWindow::on_pbOpenMask_clicked);
     connect(pbComputeSeams, &QPushButton::clicked, this, &MainWindow::on_pbComputeSeams_clicked); 
     connect(pbRemoveSeams,  &QPushButton::clicked, this, &MainWindow::on_pbRemoveSeams_clicked);
+    connect(pbInsertSeams,  &QPushButton::clicked, this, &MainWindow::on_pbInsertSeams_clicked);
     connect(pbSaveImage, 	&QPushButton::clicked, this, &MainWindow::on_pbSaveImage_clicked);
+    connect(pbCancel,       &QPushButton::clicked, this, &MainWindow::on_pbCancel_clicked);
+    connect(pbLiveResize,   &QPushButton::clicked, this, &MainWindow::on_pbLiveResize_clicked);
+    connect(sbCols, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &MainWindow::on_sbSize_valueChanged);
+    connect(sbRows, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &MainWindow::on_sbSize_valueChanged);
+
+    /* the worker emits from its own thread, so these are queued to the GUI thread */
+    connect(&worker, &SeamWorker::finished, this, &MainWindow::onWorkerFinished);
+    connect(&worker, &SeamWorker::progress, this, &MainWindow::onWorkerProgress);
+    connect(&worker, &SeamWorker::preview,  this, &MainWindow::onWorkerPreview);
 }
 
 void MainWindow::enableGUI()
@@ -240,9 +464,17 @@ void MainWindow::enableGUI()
     
     sbCols->setEnabled(true);
     sbRows->setEnabled(true);
+    cbIterative->setEnabled(true);
+    cbSeamMap->setEnabled(true);
+    cbOptimalOrder->setEnabled(true);
+    cbPyramid->setEnabled(true);
+    cbEnergy->setEnabled(true);
+    pbOpenMask->setEnabled(true);
     
     pbComputeSeams->setEnabled(true);
     pbRemoveSeams->setEnabled(true);
+    pbInsertSeams->setEnabled(true);
+    pbLiveResize->setEnabled(true);
     
     sbRows->setMinimum(0);
     sbRows->setMaximum(originalImage.rows);
@@ -262,10 +494,43 @@ void MainWindow::disableGUI()
     
     sbCols->setEnabled(false);
     sbRows->setEnabled(false);
+    cbIterative->setEnabled(false);
+    cbSeamMap->setEnabled(false);
+    cbOptimalOrder->setEnabled(false);
+    cbPyramid->setEnabled(false);
+    cbEnergy->setEnabled(false);
+    pbOpenMask->setEnabled(false);
     
     pbComputeSeams->setEnabled(false);
     pbRemoveSeams->setEnabled(false);
+    pbInsertSeams->setEnabled(false);
     pbSaveImage->setEnabled(false);
+    pbLiveResize->setEnabled(false);
+}
+
+void MainWindow::setBusy(bool busy)
+{
+    /* the original image, the mask and the seams are shared with the running job */
+    pbOpenImage->setEnabled(!busy);
+    pbOpenMask->setEnabled(!busy);
+    pbComputeSeams->setEnabled(!busy);
+    pbRemoveSeams->setEnabled(!busy);
+    pbInsertSeams->setEnabled(!busy);
+    pbCancel->setEnabled(busy);
+}
+
+void MainWindow::maskSizeError()
+{
+    QMessageBox messageBox;
+    messageBox.critical(0, "Invalid Mask", "The mask could not be read or does not have the size of the image.");
+    messageBox.show();
+}
+
+void MainWindow::saveError(const QString& fileName, const QString& reason)
+{
+    QMessageBox messageBox;
+    messageBox.critical(0, "Image Not Saved", QString("The image could not be saved as %1. %2").arg(fileName, reason));
+    messageBox.show();
 }
 
 void MainWindow::noSeamsError()
@@ -4,22 +4,31 @@
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <utility>
 
 #include <QMainWindow>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QPushButton>
 #include <QBoxLayout>
 #include <QSpinBox>
+#include <QCheckBox>
+#include <QComboBox>
 #include <QLabel>
 #include <QGroupBox>
 #include <QStatusBar>
 #include <QMessageBox>
+#include <QProgressBar>
 
 #include "ImageReader.hpp"
+#include "Instrumentation.hpp"
+#include "LiveResizeWindow.hpp"
 #include "QtOpencvCore.hpp"
 #include "opencv2/core/core.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include "SeamFunctions.hpp"
+#include "SeamMap.hpp"
+#include "SeamWorker.hpp"
 
 
 class MainWindow : public QMainWindow
@@ -38,9 +47,21 @@ private slots:
     
     /* Funktionen werden ausgeloest, wenn auf den entsprechenden Button geklickt wird */
     void on_pbOpenImage_clicked();
+    void on_pbOpenMask_clicked();
     void on_pbComputeSeams_clicked();
     void on_pbRemoveSeams_clicked();
+    void on_pbInsertSeams_clicked();
     void on_pbSaveImage_clicked();
+    void on_pbCancel_clicked();
+    void on_pbLiveResize_clicked();
+
+    /* Retargets the image instantly, if the seam map of the image was computed. */
+    void on_sbSize_valueChanged();
+
+    /* Take over the results of the worker and show its intermediate images. */
+    void onWorkerFinished();
+    void onWorkerProgress(int done, int total);
+    void onWorkerPreview(QString title, cv::Mat image);
     
 private:
 
@@ -55,9 +76,15 @@ private:
     QVBoxLayout *verticalLayout_3;
     
     QPushButton *pbOpenImage;
+    QPushButton *pbOpenMask;
     QPushButton *pbRemoveSeams;
+    QPushButton *pbInsertSeams;
     QPushButton *pbComputeSeams;
     QPushButton *pbSaveImage;
+    QPushButton *pbCancel;
+    QPushButton *pbLiveResize;
+
+    QProgressBar *progressBar;
     
     QLabel      *lCaption;
     QLabel      *lCols;
@@ -65,6 +92,13 @@ private:
     
     QSpinBox    *sbCols;
     QSpinBox    *sbRows;
+
+    QCheckBox   *cbIterative;
+    QCheckBox   *cbSeamMap;
+    QCheckBox   *cbOptimalOrder;
+    QCheckBox   *cbPyramid;
+
+    QComboBox   *cbEnergy;
     
     QSpacerItem *verticalSpacer;
     QSpacerItem *horizontalSpacer;
@@ -72,20 +106,54 @@ private:
     
     /* Originalbild */
     cv::Mat         originalImage;
+    /* Mask with pixels to protect and to remove, empty if there is none. */
+    cv::Mat         maskImage;
     /* Picture with deleted seams. */
     cv::Mat 		modifiedImage;
 
+    /* Removal order of all seams of the original image, empty until it is computed. */
+    seam::SeamMap   seamMap;
+
     /* computed seams */
     std::vector<std::vector<int>> seamsHorizontal;
     std::vector<std::vector<int>> seamsVertical;
+
+    /* Runs the seam computations off the GUI thread, one job at a time. */
+    SeamWorker      worker;
+
+    /* Window, which retargets the image while it is resized, shown by "Live Resize". */
+    LiveResizeWindow *liveResizeWindow;
+
+    /* What to do with the seam map, when its job is finished. */
+    bool            retargetWhenMapped;
+    bool            liveResizeWhenMapped;
     
     /* Methode initialisiert die UI */
     void setupUi();
     
+    /* Method that retargets the original image with the seam map to the size of the spin boxes and shows it. */
+    void retargetSeamMap();
+
     /* Methoden aktivieren bzw. deaktivieren die UI */
     void enableGUI();
     void disableGUI();
 
+    /* Method that computes the seam map of the original image without previews, e.g. for "Live Resize". */
+    void startSeamMapJob();
+
+    /* Method that shows the live resize window with the seam map. */
+    void showLiveResize();
+
+    /* Method that starts a job of the worker and disables the buttons, which would start another one. */
+    void startJob(SeamWorker::Job job);
+    void setBusy(bool busy);
+
+    /* Method that shows error message that the mask does not have the size of the image. */
+    void maskSizeError();
+
+    /* Method that shows error message that the image could not be saved, e.g. because of its format. */
+    void saveError(const QString& fileName, const QString& reason);
+
     /* Method that shows error message that no seams are present that can be removed. */
     void noSeamsError();
 
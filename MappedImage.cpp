@@ -0,0 +1,171 @@
+#include "MappedImage.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Instrumentation.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEAM_POSIX_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    /* rows of created files start at a multiple of this */
+    const size_t ROW_ALIGNMENT = 16;
+
+#ifdef SEAM_POSIX_MMAP
+    /**
+     * @brief Allocates the space of a file on disk, so a full disk is reported here instead of failing writes
+     * into the mapping. macOS only sets the size.
+     */
+    bool allocate(int file, size_t size)
+    {
+#ifdef __APPLE__
+        return ftruncate(file, static_cast<off_t>(size)) == 0;
+#else
+        return posix_fallocate(file, 0, static_cast<off_t>(size)) == 0;
+#endif
+    }
+#endif
+} // namespace
+
+seam::MappedImage::MappedImage() :
+    data(nullptr), length(0), shared(false), device(0), inode(0)
+{
+}
+
+seam::MappedImage::~MappedImage()
+{
+    unmap();
+}
+
+void seam::MappedImage::unmap()
+{
+#ifdef SEAM_POSIX_MMAP
+    if (data)
+        munmap(data, length);
+    /* a created file, which wasn't closed successfully, would look like a valid image of zeros */
+    if (!createdPath.empty())
+        unlink(createdPath.c_str());
+#endif
+    createdPath.clear();
+    data = nullptr;
+    length = 0;
+    pixels.release();
+}
+
+bool seam::MappedImage::open(const std::string& path)
+{
+    unmap();
+#ifdef SEAM_POSIX_MMAP
+    PnmHeader header;
+    {
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream || !readPnmHeader(stream, header))
+            return false;
+    }
+    /* 16 bit samples are converted in place, which needs aligned rows */
+    if (header.dataOffset % CV_ELEM_SIZE1(header.type) != 0)
+        return false;
+
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+    struct stat status;
+    const size_t size = header.dataOffset + header.height * header.rowBytes();
+    void* mapping = MAP_FAILED;
+    if (fstat(file, &status) == 0 && static_cast<size_t>(status.st_size) >= size)
+        mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    SEAM_COUNT("files_mapped", 1);
+    data = static_cast<uchar*>(mapping);
+    length = size;
+    shared = false;
+    device = static_cast<unsigned long long>(status.st_dev);
+    inode = static_cast<unsigned long long>(status.st_ino);
+    pixels = cv::Mat(header.height, header.width, header.type, data + header.dataOffset, header.rowBytes());
+    convertPnmRows(pixels);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool seam::MappedImage::create(const std::string& path, cv::Size size, int type)
+{
+    unmap();
+#ifdef SEAM_POSIX_MMAP
+    CV_Assert(type == CV_8UC1 || type == CV_8UC3 || type == CV_16UC1 || type == CV_16UC3);
+    /* a comment after the magic number pads the header */
+    std::string header = pnmHeader(size.width, size.height, type);
+    const size_t padding = (ROW_ALIGNMENT - (header.size() + 2) % ROW_ALIGNMENT) % ROW_ALIGNMENT;
+    header.insert(3, "#" + std::string(padding, ' ') + "\n");
+    const size_t rowBytes = static_cast<size_t>(size.width) * CV_ELEM_SIZE(type);
+    const size_t fileSize = header.size() + size.height * rowBytes;
+
+    const int file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+        return false;
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    if (allocate(file, fileSize) && fstat(file, &status) == 0)
+        mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    ::close(file);
+    if (mapping == MAP_FAILED) {
+        unlink(path.c_str());
+        return false;
+    }
+
+    SEAM_COUNT("files_mapped", 1);
+    createdPath = path;
+    data = static_cast<uchar*>(mapping);
+    length = fileSize;
+    shared = true;
+    device = static_cast<unsigned long long>(status.st_dev);
+    inode = static_cast<unsigned long long>(status.st_ino);
+    std::copy(header.begin(), header.end(), data);
+    pixels = cv::Mat(size.height, size.width, type, data + header.size(), rowBytes);
+    return true;
+#else
+    (void)path;
+    (void)size;
+    (void)type;
+    return false;
+#endif
+}
+
+bool seam::MappedImage::close()
+{
+    bool success = true;
+#ifdef SEAM_POSIX_MMAP
+    if (data && shared) {
+        convertPnmRows(pixels);
+        /* MS_SYNC waits for the write back, so its errors, e.g. of a network file system, are reported here */
+        success = msync(data, length, MS_SYNC) == 0;
+        if (success)
+            createdPath.clear();
+    }
+#endif
+    unmap();
+    return success;
+}
+
+bool seam::MappedImage::isFile(const std::string& path) const
+{
+#ifdef SEAM_POSIX_MMAP
+    struct stat status;
+    return data && stat(path.c_str(), &status) == 0 && static_cast<unsigned long long>(status.st_dev) == device &&
+           static_cast<unsigned long long>(status.st_ino) == inode;
+#else
+    (void)path;
+    return false;
+#endif
+}
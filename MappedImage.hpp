@@ -0,0 +1,78 @@
+#ifndef MAPPEDIMAGE_HPP
+#define MAPPEDIMAGE_HPP
+
+#include <string>
+
+#include "opencv2/core/core.hpp"
+#include "PnmFile.hpp"
+
+namespace seam {
+    /**
+     * @brief A binary PGM or PPM file mapped into memory, whose rows are used as a cv::Mat without decoding.
+     *
+     * @details 8 bit PGM files are used without any copy. The channels of PPM files are in RGB order and 16 bit
+     * samples are big endian, so they are converted in place, which copies only the pages of the mapping, see
+     * convertPnmRows(). Opened files are mapped privately, so changes of image() never reach the file. Created
+     * files are mapped shared: everything written into image() goes straight to the page cache, and close()
+     * converts it to the layout of the file. The header of a created file is padded with a comment, so the rows
+     * start 16 byte aligned. Only available on POSIX systems, elsewhere open() and create() return false.
+     */
+    class MappedImage
+    {
+    public:
+        MappedImage();
+
+        /**
+         * @brief Unmaps the file. A created file, which wasn't closed, is removed.
+         */
+        ~MappedImage();
+
+        MappedImage(const MappedImage&) = delete;
+        MappedImage& operator=(const MappedImage&) = delete;
+
+        /**
+         * @brief Maps an existing file.
+         * @return false, if it isn't a binary PGM or PPM file or can't be mapped.
+         */
+        bool open(const std::string& path);
+
+        /**
+         * @brief Creates a file for an image of the given size and type and maps it, the space on disk is
+         * allocated at once.
+         * @param type - CV_8UC1, CV_8UC3, CV_16UC1 or CV_16UC3.
+         * @return false, if the file can't be created or mapped.
+         */
+        bool create(const std::string& path, cv::Size size, int type);
+
+        /**
+         * @brief Converts a created image to the layout of the file, writes it to disk and unmaps it.
+         * @return false, if the file can't be written, it is removed then.
+         */
+        bool close();
+
+        /**
+         * @brief Returns true, if path is the mapped file, e.g. to not overwrite an input while it is mapped.
+         */
+        bool isFile(const std::string& path) const;
+
+        /**
+         * @brief The pixels of the file, valid until the file is closed or unmapped.
+         */
+        cv::Mat& image() { return pixels; }
+
+    private:
+        void unmap();
+
+        uchar* data;
+        size_t length;
+        bool shared;
+        /* identifies the file, see isFile() */
+        unsigned long long device;
+        unsigned long long inode;
+        /* a created file, which is removed unless close() succeeds */
+        std::string createdPath;
+        cv::Mat pixels;
+    };
+} // namespace seam
+
+#endif // MAPPEDIMAGE_HPP
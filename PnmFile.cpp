@@ -0,0 +1,113 @@
+#include "PnmFile.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <limits>
+
+namespace {
+    /**
+     * @brief Skips whitespace and comments, which run from # to the end of the line.
+     */
+    void skipSeparators(std::istream& stream)
+    {
+        int c;
+        while ((c = stream.peek()) != EOF) {
+            if (c == '#')
+                stream.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            else if (std::isspace(c))
+                stream.get();
+            else
+                break;
+        }
+    }
+
+    bool readNumber(std::istream& stream, int& value)
+    {
+        skipSeparators(stream);
+        return static_cast<bool>(stream >> value) && value > 0;
+    }
+
+    bool littleEndian()
+    {
+        const uint16_t one = 1;
+        return *reinterpret_cast<const uchar*>(&one) == 1;
+    }
+
+    inline uchar swapBytes(uchar value) { return value; }
+    inline uint16_t swapBytes(uint16_t value) { return static_cast<uint16_t>((value << 8) | (value >> 8)); }
+
+    /**
+     * @brief Swaps the first and third channel and, if swap is set, the bytes of every sample in one pass,
+     * without any other memory than the rows.
+     */
+    template <typename T>
+    void convertRows(cv::Mat& rows, bool swap)
+    {
+        const int nChannels = rows.channels();
+        if (nChannels == 1 && !swap)
+            return;
+        cv::parallel_for_(cv::Range(0, rows.rows), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                T* row = rows.ptr<T>(i);
+                T* const end = row + rows.cols * nChannels;
+                if (nChannels == 1) {
+                    for (; row < end; row++)
+                        *row = swapBytes(*row);
+                    continue;
+                }
+                for (; row < end; row += 3) {
+                    const T first = row[0];
+                    row[0] = swap ? swapBytes(row[2]) : row[2];
+                    row[1] = swap ? swapBytes(row[1]) : row[1];
+                    row[2] = swap ? swapBytes(first) : first;
+                }
+            }
+        });
+    }
+} // namespace
+
+bool seam::isPnmPath(const std::string& path)
+{
+    if (path.size() < 4)
+        return false;
+    std::string extension = path.substr(path.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".pgm" || extension == ".ppm" || extension == ".pnm";
+}
+
+bool seam::readPnmHeader(std::istream& stream, PnmHeader& header)
+{
+    char magic[2];
+    if (!stream.read(magic, 2) || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6'))
+        return false;
+    int maxValue;
+    if (!readNumber(stream, header.width) || !readNumber(stream, header.height) || !readNumber(stream, maxValue) ||
+        maxValue > 65535)
+        return false;
+    /* a single whitespace character separates the header from the rows */
+    if (!std::isspace(stream.get()))
+        return false;
+
+    const int channels = magic[1] == '5' ? 1 : 3;
+    header.type = CV_MAKETYPE(maxValue < 256 ? CV_8U : CV_16U, channels);
+    header.dataOffset = static_cast<size_t>(stream.tellg());
+    return true;
+}
+
+std::string seam::pnmHeader(int width, int height, int type)
+{
+    CV_Assert(type == CV_8UC1 || type == CV_8UC3 || type == CV_16UC1 || type == CV_16UC3);
+    return std::string(CV_MAT_CN(type) == 1 ? "P5" : "P6") + "\n" + std::to_string(width) + " " +
+           std::to_string(height) + "\n" + (CV_MAT_DEPTH(type) == CV_8U ? "255" : "65535") + "\n";
+}
+
+void seam::convertPnmRows(cv::Mat& rows)
+{
+    const int type = rows.type();
+    CV_Assert(type == CV_8UC1 || type == CV_8UC3 || type == CV_16UC1 || type == CV_16UC3);
+    if (rows.depth() == CV_8U)
+        convertRows<uchar>(rows, false);
+    else
+        convertRows<uint16_t>(rows, littleEndian());
+}
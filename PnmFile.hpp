@@ -0,0 +1,51 @@
+#ifndef PNMFILE_HPP
+#define PNMFILE_HPP
+
+#include <iostream>
+#include <string>
+
+#include "opencv2/core/core.hpp"
+
+namespace seam {
+    /**
+     * @brief Layout of a binary PGM (P5) or PPM (P6) file, whose rows follow the header without padding.
+     */
+    struct PnmHeader {
+        int width = 0;
+        int height = 0;
+        /** CV_8UC1, CV_8UC3, CV_16UC1 or CV_16UC3 */
+        int type = 0;
+        /** bytes before the first row */
+        size_t dataOffset = 0;
+
+        size_t rowBytes() const { return static_cast<size_t>(width) * CV_ELEM_SIZE(type); }
+    };
+
+    /**
+     * @brief Returns true, if the path ends with .pgm, .ppm or .pnm in any case.
+     */
+    bool isPnmPath(const std::string& path);
+
+    /**
+     * @brief Reads the header of a binary PGM or PPM file from the start of the stream.
+     * @return false, if the stream isn't a binary PGM or PPM file with a maximum value up to 65535.
+     */
+    bool readPnmHeader(std::istream& stream, PnmHeader& header);
+
+    /**
+     * @brief Returns the header of a binary PGM or PPM file of the given size and type.
+     */
+    std::string pnmHeader(int width, int height, int type);
+
+    /**
+     * @brief Converts rows between the layout of the file and the one of OpenCV in place, in both directions.
+     *
+     * @param rows - CV_8UC1, CV_8UC3, CV_16UC1 or CV_16UC3, e.g. the rows of a mapped file.
+     *
+     * @details PPM files store the channels in RGB order and 16 bit samples in big endian byte order, OpenCV
+     * uses BGR and the byte order of the machine. The rows keep their memory.
+     */
+    void convertPnmRows(cv::Mat& rows);
+} // namespace seam
+
+#endif // PNMFILE_HPP
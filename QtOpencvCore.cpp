@@ -1,33 +1,66 @@
 #include "QtOpencvCore.hpp"
+#include "Instrumentation.hpp"
+
+namespace
+{
+    /**
+     * @brief Converts the colors of img into a new RGB888 QImage, for Qt versions without a matching format.
+     */
+    QImage convertedCopy(const cv::Mat& img, int code)
+    {
+        QImage qimage(img.cols, img.rows, QImage::Format_RGB888);
+        cv::Mat rgb(img.rows, img.cols, CV_8UC3, qimage.bits(), qimage.bytesPerLine());
+        cv::cvtColor(img, rgb, code);
+        SEAM_COUNT("bytes_copied", rgb.total() * rgb.elemSize());
+        return qimage;
+    }
+} // namespace
 
 namespace QtOpencvCore
 {
-    QImage img2qimg(cv::Mat& img)
+    QImage img2qimgView(const cv::Mat& img)
     {
-        QImage qimage;
-
-         // convert the color to RGB (OpenCV uses BGR)
-         switch (img.type()) {
-         case CV_8UC1:
-            cv::cvtColor(img, img, CV_GRAY2RGB);
-            qimage = QImage((uchar*) img.data, img.cols, img.rows, img.step, QImage::Format_RGB888);
-            cv::cvtColor(img, img, CV_RGB2GRAY);
-            break;
-         case CV_8UC3:
-            cv::cvtColor(img, img, CV_BGR2RGB);
-            qimage = QImage((uchar*) img.data, img.cols, img.rows, img.step, QImage::Format_RGB888);
-            cv::cvtColor(img, img, CV_RGB2BGR);
-            break;
-         }
-
-
-         // return the QImage
-         return qimage;
+        // the const constructor makes the QImage read-only, so it copies the pixels before modifying them
+        switch (img.type()) {
+        case CV_8UC1:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+            return QImage(img.ptr<const uchar>(), img.cols, img.rows, static_cast<int>(img.step),
+                          QImage::Format_Grayscale8);
+#else
+            return convertedCopy(img, cv::COLOR_GRAY2RGB);
+#endif
+        case CV_8UC3:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+            return QImage(img.ptr<const uchar>(), img.cols, img.rows, static_cast<int>(img.step),
+                          QImage::Format_BGR888);
+#else
+            return convertedCopy(img, cv::COLOR_BGR2RGB);
+#endif
+        case CV_8UC4:
+            // ARGB32 is stored as B, G, R, A on little endian machines
+            return QImage(img.ptr<const uchar>(), img.cols, img.rows, static_cast<int>(img.step),
+                          QImage::Format_ARGB32);
+        default:
+            return QImage();
+        }
     }
-    
-    QPixmap img2qpix(cv::Mat& img)
+
+    QImage img2qimg(const cv::Mat& img)
+    {
+        SEAM_SCOPED_TIMER("qt.img2qimg");
+        QImage qimage = img2qimgView(img);
+        // a view still points to img, a converted copy already owns its pixels
+        if (!qimage.isNull() && qimage.constBits() == img.data) {
+            qimage = qimage.copy();
+            SEAM_COUNT("bytes_copied", img.total() * img.elemSize());
+        }
+        return qimage;
+    }
+
+    QPixmap img2qpix(const cv::Mat& img)
     {
-        return QPixmap::fromImage(img2qimg(img));
+        // the pixmap copies the pixels anyway, so a view is enough
+        return QPixmap::fromImage(img2qimgView(img));
     }
 
     std::string qstr2str(QString const& qstr)
@@ -44,9 +77,28 @@ namespace QtOpencvCore
 
     cv::Mat qimg2img(const QImage &qimg)
     {
-        cv::Mat img;
-        img = cv::Mat(qimg.height(), qimg.width(), CV_8UC4, const_cast<uchar*>(qimg.bits()), qimg.bytesPerLine());
-        return img;
+        uchar* data = const_cast<uchar*>(qimg.constBits());
+        const size_t step = static_cast<size_t>(qimg.bytesPerLine());
+        switch (qimg.format()) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+        case QImage::Format_Grayscale8:
+            return cv::Mat(qimg.height(), qimg.width(), CV_8UC1, data, step);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        case QImage::Format_BGR888:
+            return cv::Mat(qimg.height(), qimg.width(), CV_8UC3, data, step);
+#endif
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+            return cv::Mat(qimg.height(), qimg.width(), CV_8UC4, data, step);
+        default: {
+            // the converted QImage is destroyed on return, so the cv::Mat needs its own copy
+            const QImage converted = qimg.convertToFormat(QImage::Format_ARGB32);
+            SEAM_COUNT("bytes_copied", 2 * static_cast<size_t>(converted.bytesPerLine()) * converted.height());
+            return cv::Mat(converted.height(), converted.width(), CV_8UC4, const_cast<uchar*>(converted.constBits()),
+                           static_cast<size_t>(converted.bytesPerLine())).clone();
+        }
+        }
     }
 
 } // namespace QtOpencvCore
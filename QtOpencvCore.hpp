@@ -13,19 +13,40 @@
 
 namespace QtOpencvCore
 {
+    /**
+     * @brief Wraps a cv::Mat image of type CV_8UC1, CV_8UC3 or CV_8UC4 in a QImage without copying it
+     * @param  img is a cv::Mat image which will be shown by the QImage, it is never modified
+     * @return QImage of the cv::Mat image img, a null QImage for other types
+     *
+     * @details The QImage points to the pixels of img with the matching format (grayscale, BGR or BGRA), so
+     * it is only valid as long as img isn't released or modified. Modifying the QImage detaches it from img.
+     * Qt versions without Format_BGR888 (before 5.14) have no matching format for CV_8UC3, then the QImage
+     * owns an RGB copy instead.
+     */
+    QImage img2qimgView(const cv::Mat& img);
+
     /**
      * @brief This function takes a cv::Mat image and converts it to a QImage
-     * @param  img is a cv::Mat image which will be converted to a QImage
-     * @return QImage of the cv::Mat image img
+     * @param  img is a cv::Mat image which will be converted to a QImage, it is never modified
+     * @return QImage of the cv::Mat image img, a null QImage for types other than CV_8UC1, CV_8UC3 and CV_8UC4
+     *
+     * @details The QImage owns its pixels, which are copied exactly once.
+     */
+    QImage img2qimg(const cv::Mat& img);
+
+    /**
+     * @brief Converts a cv::Mat image to a QPixmap, the pixels are copied once into the pixmap.
      */
-    QImage img2qimg(cv::Mat& img);
+    QPixmap img2qpix(const cv::Mat& img);
 
-    QPixmap img2qpix(cv::Mat& img);
-    
     /**
      * @brief This function takes a QImage image and converts it to a cv::Mat
      * @param  qimg is a QImage image which will be converted to a cv::Mat
      * @return cv::Mat of the QImage img
+     *
+     * @details Grayscale, BGR (Qt 5.14) and 32 bit images are returned as a CV_8UC1, CV_8UC3 or CV_8UC4
+     * cv::Mat, which points to the pixels of qimg and is only valid as long as qimg isn't modified or
+     * destroyed. All other formats are converted to a CV_8UC4 cv::Mat with its own pixels.
      */
     cv::Mat qimg2img(QImage const &qimg);
 
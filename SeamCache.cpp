@@ -0,0 +1,292 @@
+#include "SeamCache.hpp"
+#include "Instrumentation.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char MAGIC[8] = {'S', 'C', 'S', 'E', 'A', 'M', 'S', '2'};
+
+    /* magic, image and mask hash, function, rows, cols and the number of vertical and horizontal seams */
+    const size_t HEADER_SIZE = 8 + 2 * 8 + 5 * 4;
+
+    const uint64_t FNV_OFFSET = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+
+    uint64_t fnv1a(uint64_t hash, const uchar* data, size_t size)
+    {
+        for (size_t b = 0; b < size; b++)
+            hash = (hash ^ data[b]) * FNV_PRIME;
+        return hash;
+    }
+
+    uint64_t fnv1a(uint64_t hash, uint64_t value)
+    {
+        for (int b = 0; b < 8; b++)
+            hash = (hash ^ ((value >> (8 * b)) & 0xFF)) * FNV_PRIME;
+        return hash;
+    }
+
+    /* the file is little endian on every platform */
+    void putUint(std::string& buffer, uint64_t value, int bytes)
+    {
+        for (int b = 0; b < bytes; b++)
+            buffer += static_cast<char>((value >> (8 * b)) & 0xFF);
+    }
+
+    uint64_t getUint(const uchar* data, int bytes)
+    {
+        uint64_t value = 0;
+        for (int b = 0; b < bytes; b++)
+            value |= static_cast<uint64_t>(data[b]) << (8 * b);
+        return value;
+    }
+
+    void putVarint(std::string& buffer, uint32_t value)
+    {
+        while (value >= 0x80) {
+            buffer += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        buffer += static_cast<char>(value);
+    }
+
+    bool getVarint(const uchar*& data, const uchar* end, uint32_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 35 && data < end; shift += 7) {
+            const uchar byte = *data++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    /* maps small differences of either sign to small unsigned values: 0, -1, 1, -2, ... to 0, 1, 2, 3, ... */
+    uint32_t zigzag(int value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    int unzigzag(uint32_t value)
+    {
+        return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+    }
+
+    void encodeSeams(std::string& buffer, const std::vector<std::vector<int>>& seams)
+    {
+        for (const std::vector<int>& seam : seams) {
+            putVarint(buffer, static_cast<uint32_t>(seam[0]));
+            for (size_t s = 1; s < seam.size(); s++)
+                putVarint(buffer, zigzag(seam[s] - seam[s-1]));
+        }
+    }
+
+    /**
+     * @brief Decodes count seams with length entries each, which have to be in [0, limit).
+     */
+    bool decodeSeams(const uchar*& data, const uchar* end, size_t count, int length, int limit,
+                     std::vector<std::vector<int>>& seams)
+    {
+        seams.assign(count, std::vector<int>(length));
+        uint32_t value;
+        for (std::vector<int>& seam : seams) {
+            int entry = 0;
+            for (int s = 0; s < length; s++) {
+                if (!getVarint(data, end, value))
+                    return false;
+                entry = s == 0 ? static_cast<int>(value) : entry + unzigzag(value);
+                if (entry < 0 || entry >= limit)
+                    return false;
+                seam[s] = entry;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Read-only view of a whole file, memory mapped where possible.
+     */
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& path) : bytes(nullptr), length(0)
+        {
+#ifdef _WIN32
+            std::ifstream file(path, std::ios::binary);
+            buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            bytes = reinterpret_cast<const uchar*>(buffer.data());
+            length = buffer.size();
+#else
+            int descriptor = open(path.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                return;
+            struct stat status;
+            if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+                void* mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE,
+                                     descriptor, 0);
+                if (mapping != MAP_FAILED) {
+                    bytes = static_cast<const uchar*>(mapping);
+                    length = static_cast<size_t>(status.st_size);
+                }
+            }
+            close(descriptor);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifndef _WIN32
+            if (bytes)
+                munmap(const_cast<uchar*>(bytes), length);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const uchar* data() const { return bytes; }
+        size_t size() const { return length; }
+
+    private:
+        const uchar* bytes;
+        size_t length;
+#ifdef _WIN32
+        std::string buffer;
+#endif
+    };
+
+    int processId()
+    {
+#ifdef _WIN32
+        return _getpid();
+#else
+        return static_cast<int>(getpid());
+#endif
+    }
+} // namespace
+
+uint64_t seam::contentHash(const cv::Mat& image)
+{
+    if (image.empty())
+        return 0;
+    uint64_t hash = fnv1a(FNV_OFFSET, static_cast<uint64_t>(image.rows));
+    hash = fnv1a(hash, static_cast<uint64_t>(image.cols));
+    hash = fnv1a(hash, static_cast<uint64_t>(image.type()));
+    const size_t rowSize = image.cols * image.elemSize();
+    for (int i = 0; i < image.rows; i++)
+        hash = fnv1a(hash, image.ptr<uchar>(i), rowSize);
+    return hash;
+}
+
+seam::SeamCache::SeamCache(const std::string& directory) : directory(directory)
+{
+}
+
+seam::SeamCacheKey seam::SeamCache::key(const cv::Mat& image, EnergyFunction function, const cv::Mat& mask)
+{
+    SEAM_SCOPED_TIMER("cache.hash");
+    SeamCacheKey key;
+    key.imageHash = contentHash(image);
+    key.maskHash = contentHash(mask);
+    key.function = function;
+    key.rows = image.rows;
+    key.cols = image.cols;
+    return key;
+}
+
+std::string seam::SeamCache::path(const SeamCacheKey& key) const
+{
+    uint64_t hash = fnv1a(FNV_OFFSET, key.imageHash);
+    hash = fnv1a(hash, key.maskHash);
+    hash = fnv1a(hash, static_cast<uint64_t>(key.function));
+    std::ostringstream name;
+    name << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".seams";
+    return name.str();
+}
+
+bool seam::SeamCache::load(const SeamCacheKey& key, std::vector<std::vector<int>>& verticalSeams,
+                           std::vector<std::vector<int>>& horizontalSeams) const
+{
+    SEAM_SCOPED_TIMER("cache.load");
+    MappedFile file(path(key));
+    const uchar* data = file.data();
+    if (!data || file.size() < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+        return false;
+
+    /* the name is only a hash of the key, so the header has to match it */
+    const uint64_t verticalCount = getUint(data + 36, 4), horizontalCount = getUint(data + 40, 4);
+    if (getUint(data + 8, 8) != key.imageHash || getUint(data + 16, 8) != key.maskHash ||
+        getUint(data + 24, 4) != static_cast<uint64_t>(key.function) ||
+        getUint(data + 28, 4) != static_cast<uint64_t>(key.rows) ||
+        getUint(data + 32, 4) != static_cast<uint64_t>(key.cols) ||
+        verticalCount >= static_cast<uint64_t>(key.cols) || horizontalCount >= static_cast<uint64_t>(key.rows))
+        return false;
+
+    /* the horizontal seams run through the image without the vertical seams */
+    const int narrowCols = key.cols - static_cast<int>(verticalCount);
+    const uchar* end = data + file.size();
+    data += HEADER_SIZE;
+    if (!decodeSeams(data, end, verticalCount, key.rows, key.cols, verticalSeams) ||
+        !decodeSeams(data, end, horizontalCount, narrowCols, key.rows, horizontalSeams)) {
+        verticalSeams.clear();
+        horizontalSeams.clear();
+        return false;
+    }
+    return true;
+}
+
+bool seam::SeamCache::store(const SeamCacheKey& key, const std::vector<std::vector<int>>& verticalSeams,
+                            const std::vector<std::vector<int>>& horizontalSeams) const
+{
+    SEAM_SCOPED_TIMER("cache.store");
+    CV_Assert(verticalSeams.size() < static_cast<size_t>(key.cols) &&
+              horizontalSeams.size() < static_cast<size_t>(key.rows));
+    std::string buffer(MAGIC, sizeof(MAGIC));
+    putUint(buffer, key.imageHash, 8);
+    putUint(buffer, key.maskHash, 8);
+    putUint(buffer, static_cast<uint64_t>(key.function), 4);
+    putUint(buffer, static_cast<uint64_t>(key.rows), 4);
+    putUint(buffer, static_cast<uint64_t>(key.cols), 4);
+    putUint(buffer, verticalSeams.size(), 4);
+    putUint(buffer, horizontalSeams.size(), 4);
+    encodeSeams(buffer, verticalSeams);
+    encodeSeams(buffer, horizontalSeams);
+
+    /* the temporary name is unique per process and call, so concurrent writers don't interfere */
+    static std::atomic<int> counter(0);
+    const std::string filePath = path(key);
+    const std::string temporaryPath = filePath + ".tmp" + std::to_string(processId()) + "." +
+                                      std::to_string(counter++);
+    {
+        std::ofstream file(temporaryPath, std::ios::binary);
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        /* a short write or a failed flush must not be renamed into a valid looking file */
+        file.close();
+        if (!file) {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), filePath.c_str()) != 0) {
+        /* on some platforms rename doesn't replace a file, which another writer stored in the meantime */
+        std::remove(temporaryPath.c_str());
+        return std::ifstream(filePath).good();
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef SEAMCACHE_HPP
+#define SEAMCACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "SeamFunctions.hpp"
+
+namespace seam {
+    /**
+     * @brief 64 bit FNV-1a hash of the size, type and pixels of an image, 0 for an empty image.
+     */
+    uint64_t contentHash(const cv::Mat& image);
+
+    /**
+     * @brief Identifies the seams of an image, which were computed with an energy function and a mask.
+     */
+    struct SeamCacheKey {
+        uint64_t imageHash;
+        uint64_t maskHash;
+        EnergyFunction function;
+        int rows;
+        int cols;
+    };
+
+    /**
+     * @brief Directory of seam files, so that the seams of an image are only computed once.
+     *
+     * @details There is one file per key, named after a hash of it. It starts with a header, which repeats the
+     * key, followed by the vertical and then the horizontal seams in their order, like carve() removes them:
+     * the vertical seams run through the image, the horizontal seams through the image without all vertical
+     * seams. Every seam is stored as its first entry and the difference of each entry to the previous one,
+     * zigzag and varint encoded, so the usual differences of -1, 0 and 1 take one byte each.
+     * Files are decoded straight from a read-only memory mapping into the seams, and written to a temporary
+     * file, which is renamed afterwards, so that concurrent readers never see a partial file.
+     */
+    class SeamCache
+    {
+    public:
+        /**
+         * @param directory - an existing directory.
+         */
+        explicit SeamCache(const std::string& directory);
+
+        /**
+         * @brief Computes the key of an image.
+         * @param mask - optional mask with MaskValue entries, see energy().
+         */
+        static SeamCacheKey key(const cv::Mat& image, EnergyFunction function, const cv::Mat& mask = cv::Mat());
+
+        /**
+         * @brief Returns the path of the file for a key.
+         */
+        std::string path(const SeamCacheKey& key) const;
+
+        /**
+         * @brief Reads the seams of a key.
+         * @return false, if there is no valid file for the key.
+         */
+        bool load(const SeamCacheKey& key, std::vector<std::vector<int>>& verticalSeams,
+                  std::vector<std::vector<int>>& horizontalSeams) const;
+
+        /**
+         * @brief Writes the seams of a key, e.g. the ones of removalOrderVertical() and of removalOrderHorizontal()
+         * on the image without the vertical seams.
+         * @return false, if the file could not be written completely.
+         */
+        bool store(const SeamCacheKey& key, const std::vector<std::vector<int>>& verticalSeams,
+                   const std::vector<std::vector<int>>& horizontalSeams) const;
+
+    private:
+        std::string directory;
+    };
+} // namespace seam
+
+#endif // SEAMCACHE_HPP
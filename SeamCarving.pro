@@ -6,7 +6,7 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = SeamCarving
 TEMPLATE = app
@@ -18,12 +18,24 @@ SOURCES += main.cpp\
         MainWindow.cpp \
         ImageReader.cpp \
         QtOpencvCore.cpp \
-        SeamFunctions.cpp
+        SeamFunctions.cpp \
+        SeamContext.cpp \
+        SeamPyramid.cpp \
+        SeamMap.cpp \
+        SeamWorker.cpp \
+        LiveResizeWindow.cpp \
+        Instrumentation.cpp
 
 HEADERS  += MainWindow.hpp \
         ImageReader.hpp \
         QtOpencvCore.hpp \
-    SeamFunctions.hpp
+    SeamFunctions.hpp \
+    SeamContext.hpp \
+    SeamPyramid.hpp \
+    SeamMap.hpp \
+    SeamWorker.hpp \
+    LiveResizeWindow.hpp \
+    Instrumentation.hpp
 
 FORMS    +=
 
@@ -36,6 +48,11 @@ win32 {
     # Windows Compiler Flags
 }
 
+# qmake CONFIG+=instrumentation compiles in the timers and counters of Instrumentation.hpp
+CONFIG(instrumentation) {
+    DEFINES += SEAM_INSTRUMENTATION
+}
+
 unix {
 
     QMAKE_CXXFLAGS += -std=c++11 -Wall -pedantic -Wno-unknown-pragmas
@@ -0,0 +1,50 @@
+#-------------------------------------------------
+#
+# Microbenchmarks of the seam functions. Build with
+#   qmake SeamCarvingBench.pro -o Makefile.bench && make -f Makefile.bench
+#   ./seambench --json results.json
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = seambench
+TEMPLATE = app
+CONFIG += console release
+CONFIG -= app_bundle qt
+
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+SOURCES += benchmark.cpp \
+        ImageReader.cpp \
+        SeamFunctions.cpp \
+        SeamContext.cpp \
+        SeamPyramid.cpp \
+        SeamMap.cpp \
+        Instrumentation.cpp
+
+HEADERS  += ImageReader.hpp \
+    SeamFunctions.hpp \
+    SeamContext.hpp \
+    SeamPyramid.hpp \
+    SeamMap.hpp \
+    Instrumentation.hpp
+
+# qmake CONFIG+=instrumentation compiles in the timers and counters of Instrumentation.hpp
+CONFIG(instrumentation) {
+    DEFINES += SEAM_INSTRUMENTATION
+}
+
+unix {
+
+    QMAKE_CXXFLAGS += -std=c++11 -Wall -pedantic -Wno-unknown-pragmas
+
+    INCLUDEPATH += /usr/include
+
+    LIBS += -L/usr/local/lib \
+            -lopencv_core \
+            -lopencv_imgproc \
+            -lopencv_imgcodecs
+
+    QMAKE_CXXFLAGS_WARN_ON = -Wno-unused-variable -Wno-reorder
+}
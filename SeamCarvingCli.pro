@@ -0,0 +1,65 @@
+#-------------------------------------------------
+#
+# Headless command line carver, links neither Qt
+# nor highgui. Build with
+#   qmake SeamCarvingCli.pro -o Makefile.cli && make -f Makefile.cli
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = seamcarve
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+CONFIG += thread
+
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+SOURCES += main_cli.cpp \
+        BatchCarver.cpp \
+        VideoCarver.cpp \
+        StreamCarver.cpp \
+        PnmFile.cpp \
+        MappedImage.cpp \
+        ImageReader.cpp \
+        SeamFunctions.cpp \
+        SeamContext.cpp \
+        SeamPyramid.cpp \
+        SeamMap.cpp \
+        SeamCache.cpp \
+        Instrumentation.cpp
+
+HEADERS  += ImageReader.hpp \
+    BatchCarver.hpp \
+    VideoCarver.hpp \
+    StreamCarver.hpp \
+    PnmFile.hpp \
+    MappedImage.hpp \
+    BoundedQueue.hpp \
+    SeamFunctions.hpp \
+    SeamContext.hpp \
+    SeamPyramid.hpp \
+    SeamMap.hpp \
+    SeamCache.hpp \
+    Instrumentation.hpp
+
+# qmake CONFIG+=instrumentation compiles in the timers and counters of Instrumentation.hpp
+CONFIG(instrumentation) {
+    DEFINES += SEAM_INSTRUMENTATION
+}
+
+unix {
+
+    QMAKE_CXXFLAGS += -std=c++11 -Wall -pedantic -Wno-unknown-pragmas
+
+    INCLUDEPATH += /usr/include
+
+    LIBS += -L/usr/local/lib \
+            -lopencv_core \
+            -lopencv_imgproc \
+            -lopencv_imgcodecs \
+            -lopencv_videoio
+
+    QMAKE_CXXFLAGS_WARN_ON = -Wno-unused-variable -Wno-reorder
+}
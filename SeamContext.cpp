@@ -0,0 +1,87 @@
+#include "SeamContext.hpp"
+
+#include <algorithm>
+
+/* pad rows to a multiple of 16 elements so that rows start on the same alignment */
+static size_t paddedStride(int cols)
+{
+    return (static_cast<size_t>(cols) + 2 + 15) & ~static_cast<size_t>(15);
+}
+
+const uint32_t seam::SeamContext::BLOCKED_ENERGY;
+
+seam::SeamContext::SeamContext() :
+    nrows(0), ncols(0), rowStride(0), masked(false), transposedFrom(nullptr), sumsFrom(nullptr)
+{
+}
+
+seam::SeamContext::SeamContext(int rows, int cols) : SeamContext()
+{
+    reset(rows, cols);
+}
+
+void seam::SeamContext::reset(int rows, int cols)
+{
+    CV_Assert(rows >= 0 && cols >= 0);
+    nrows = rows;
+    ncols = cols;
+    rowStride = paddedStride(cols);
+    transposedFrom = nullptr;
+    sumsFrom = nullptr;
+    masked = false;
+
+    const size_t size = rowStride * rows;
+    /* resize only grows the capacity, so a context reused for images of the same size never reallocates */
+    energySum.resize(size);
+    blocked.resize(size);
+    std::fill(energySum.begin(), energySum.begin() + size, BLOCKED_ENERGY);
+    clearBlocked();
+}
+
+void seam::SeamContext::clearBlocked()
+{
+    std::fill(blocked.begin(), blocked.begin() + rowStride * nrows, 0);
+    sumsFrom = nullptr;
+}
+
+void seam::SeamContext::setMask(const cv::Mat& mask)
+{
+    sumsFrom = nullptr;
+    masked = !mask.empty();
+    if (!masked)
+        return;
+    CV_Assert(mask.type() == CV_8UC1 && mask.rows == nrows && mask.cols == ncols);
+    /* same layout as the blocked pixels, the borders are never masked */
+    maskValues.assign(rowStride * nrows, 0);
+    for (int i = 0; i < nrows; i++) {
+        const uchar* row = mask.ptr<uchar>(i);
+        std::copy(row, row + ncols, &maskValues[static_cast<size_t>(i) * rowStride + 1]);
+    }
+}
+
+void seam::SeamContext::removeSeam(const std::vector<int>& seam)
+{
+    CV_Assert(static_cast<int>(seam.size()) == nrows && ncols > 0);
+    for (int i = 0; i < nrows; i++) {
+        /* shift the rest of the row including the right border one to the left */
+        const int j = seam[i];
+        uint32_t* sums = energyRow(i);
+        std::copy(sums + j + 1, sums + ncols + 1, sums + j);
+        uchar* mask = blockedRow(i);
+        std::copy(mask + j + 1, mask + ncols + 1, mask + j);
+        if (masked) {
+            uchar* values = &maskValues[static_cast<size_t>(i) * rowStride + 1];
+            std::copy(values + j + 1, values + ncols + 1, values + j);
+        }
+    }
+    ncols--;
+    transposedFrom = nullptr;
+    sumsFrom = nullptr;
+}
+
+uint32_t* seam::SeamContext::stripeRows(size_t size)
+{
+    if (stripeBuffer.size() < size)
+        stripeBuffer.resize(size);
+    return stripeBuffer.data();
+}
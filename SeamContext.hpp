@@ -0,0 +1,142 @@
+#ifndef SEAMCONTEXT_HPP
+#define SEAMCONTEXT_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "opencv2/core/core.hpp"
+
+namespace seam {
+    /**
+     * @brief Reusable working memory for computing multiple seams on one image.
+     *
+     * @details The context owns the table of cumulative energy sums, the mask of blocked pixels and optionally
+     * a mask of pixels to protect and to remove, which the dynamic programming adds to the costs.
+     * They are stored row-major in one contiguous buffer each, with a border column on the left and on the
+     * right of every row, so that no edge cases have to be handled. The buffers are only reallocated if the
+     * context grows, which means that computing seams does not allocate any memory.
+     * The rows of a context are the rows of the dynamic programming: for vertical seams they are the rows
+     * of the image, for horizontal seams they are the columns of the image.
+     */
+    class SeamContext
+    {
+    public:
+        /** Energy sum of blocked pixels and of the border. Leaves enough headroom to add costs without overflow. */
+        static const uint32_t BLOCKED_ENERGY = 0x7FFFFFFF;
+
+        SeamContext();
+
+        /**
+         * @brief Creates a context for a dynamic programming table with the given size.
+         * @param rows - number of rows of the table.
+         * @param cols - number of columns of the table.
+         */
+        SeamContext(int rows, int cols);
+
+        /**
+         * @brief Resizes the context, unblocks all pixels and clears the mask.
+         * @param rows - number of rows of the table.
+         * @param cols - number of columns of the table.
+         */
+        void reset(int rows, int cols);
+
+        /**
+         * @brief Unblocks all pixels.
+         */
+        void clearBlocked();
+
+        /**
+         * @brief Sets the pixels to protect from and to remove by the seams, which invalidates the energy sums.
+         * @param mask - CV_8UC1 with MaskValue entries and the size of the table, i.e. transposed for horizontal
+         *        seams, or empty to clear it.
+         */
+        void setMask(const cv::Mat& mask);
+
+        bool hasMask() const { return masked; }
+
+        /**
+         * @brief Returns the mask of a row, nullptr without a mask.
+         */
+        const uchar* maskRow(int i) const
+        {
+            return masked ? &maskValues[static_cast<size_t>(i) * rowStride + 1] : nullptr;
+        }
+
+        /**
+         * @brief Removes one column from every row, so that the energy sums left and right of it are kept.
+         * @param seam - the column to remove for every row.
+         */
+        void removeSeam(const std::vector<int>& seam);
+
+        int rows() const { return nrows; }
+        int cols() const { return ncols; }
+
+        /**
+         * @brief Returns the energy sums of a row. Index -1 and cols() are the borders.
+         */
+        uint32_t* energyRow(int i) { return &energySum[static_cast<size_t>(i) * rowStride + 1]; }
+        const uint32_t* energyRow(int i) const { return &energySum[static_cast<size_t>(i) * rowStride + 1]; }
+
+        /**
+         * @brief Returns the blocked mask of a row. Index -1 and cols() are the borders, which are never blocked.
+         */
+        uchar* blockedRow(int i) { return &blocked[static_cast<size_t>(i) * rowStride + 1]; }
+        const uchar* blockedRow(int i) const { return &blocked[static_cast<size_t>(i) * rowStride + 1]; }
+
+        bool isBlocked(int i, int j) const { return blockedRow(i)[j] != 0; }
+
+        /**
+         * @brief Blocks a pixel, which invalidates the energy sums.
+         */
+        void block(int i, int j)
+        {
+            blockedRow(i)[j] = 1;
+            sumsFrom = nullptr;
+        }
+
+        /**
+         * @brief The energy image, whose energy sums are currently stored, so that seamVertical() only has to
+         * update them downstream of the seam it blocked last. Cleared by every function, which changes the
+         * blocked pixels or the size, and by setTransposedSource().
+         */
+        const uchar* energySource() const { return sumsFrom; }
+        void setEnergySource(const uchar* source) { sumsFrom = source; }
+
+        /**
+         * @brief Buffer for the transposed energy values of horizontal seams. Keeps its memory between seams.
+         */
+        cv::Mat& transposedImage() { return transposed; }
+
+        /**
+         * @brief The image, which is currently stored transposed in transposedImage(). Cleared by reset().
+         */
+        const uchar* transposedSource() const { return transposedFrom; }
+        void setTransposedSource(const uchar* source)
+        {
+            transposedFrom = source;
+            sumsFrom = nullptr;
+        }
+
+        /**
+         * @brief Returns at least size elements of working memory for the stripes of the parallel dynamic
+         * programming. Keeps its memory between seams.
+         */
+        uint32_t* stripeRows(size_t size);
+
+    private:
+        int nrows;
+        int ncols;
+        size_t rowStride; /* number of elements per row including the borders and padding */
+
+        std::vector<uint32_t> energySum;
+        std::vector<uchar> blocked;
+        std::vector<uchar> maskValues;
+        bool masked;
+        std::vector<uint32_t> stripeBuffer;
+        cv::Mat transposed;
+        const uchar* transposedFrom;
+        const uchar* sumsFrom;
+    };
+} // namespace
+
+#endif // SEAMCONTEXT_HPP
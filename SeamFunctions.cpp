@@ -1,223 +1,2035 @@
 #include "SeamFunctions.hpp"
+#include "Instrumentation.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEAM_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+    /**
+     * @brief Computes |f_x| + |f_y| of element k, saturated to uchar.
+     * @param n - number of channels, the distance to the neighbouring pixels.
+     */
+    inline uchar sobelElement(const uchar* previous, const uchar* current, const uchar* next, int k, int n)
+    {
+        const int fx = next[k-n] + 2 * next[k] + next[k+n] - previous[k-n] - 2 * previous[k] - previous[k+n];
+        const int fy = previous[k+n] + 2 * current[k+n] + next[k+n] - previous[k-n] - 2 * current[k-n] - next[k-n];
+        return static_cast<uchar>(std::min(std::abs(fx) + std::abs(fy), static_cast<int>(UCHAR_MAX)));
+    }
+
+#ifdef SEAM_X86_KERNELS
+    /* The vector kernels compute sobelElement() for 8 or 16 elements at once in 16 bit lanes and return the
+     * element, where the scalar loop has to continue. */
+
+    __attribute__((target("sse4.1")))
+    inline __m128i loadWords8(const uchar* p)
+    {
+        return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    __attribute__((target("sse4.1")))
+    int sobelRowSSE41(const uchar* previous, const uchar* current, const uchar* next, uchar* output,
+                      int begin, int end, int n)
+    {
+        int k = begin;
+        for (; k + 8 <= end; k += 8) {
+            const __m128i pl = loadWords8(previous + k - n), pc = loadWords8(previous + k),
+                    pr = loadWords8(previous + k + n);
+            const __m128i cl = loadWords8(current + k - n), cr = loadWords8(current + k + n);
+            const __m128i nl = loadWords8(next + k - n), nc = loadWords8(next + k), nr = loadWords8(next + k + n);
+            const __m128i fx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(nl, nr), _mm_slli_epi16(nc, 1)),
+                                             _mm_add_epi16(_mm_add_epi16(pl, pr), _mm_slli_epi16(pc, 1)));
+            const __m128i fy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(pr, nr), _mm_slli_epi16(cr, 1)),
+                                             _mm_add_epi16(_mm_add_epi16(pl, nl), _mm_slli_epi16(cl, 1)));
+            const __m128i sum = _mm_add_epi16(_mm_abs_epi16(fx), _mm_abs_epi16(fy));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(output + k), _mm_packus_epi16(sum, sum));
+        }
+        return k;
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i loadWords16(const uchar* p)
+    {
+        return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    __attribute__((target("avx2")))
+    int sobelRowAVX2(const uchar* previous, const uchar* current, const uchar* next, uchar* output,
+                     int begin, int end, int n)
+    {
+        int k = begin;
+        for (; k + 16 <= end; k += 16) {
+            const __m256i pl = loadWords16(previous + k - n), pc = loadWords16(previous + k),
+                    pr = loadWords16(previous + k + n);
+            const __m256i cl = loadWords16(current + k - n), cr = loadWords16(current + k + n);
+            const __m256i nl = loadWords16(next + k - n), nc = loadWords16(next + k), nr = loadWords16(next + k + n);
+            const __m256i fx = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(nl, nr), _mm256_slli_epi16(nc, 1)),
+                                                _mm256_add_epi16(_mm256_add_epi16(pl, pr), _mm256_slli_epi16(pc, 1)));
+            const __m256i fy = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(pr, nr), _mm256_slli_epi16(cr, 1)),
+                                                _mm256_add_epi16(_mm256_add_epi16(pl, nl), _mm256_slli_epi16(cl, 1)));
+            const __m256i sum = _mm256_add_epi16(_mm256_abs_epi16(fx), _mm256_abs_epi16(fy));
+            const __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + k), bytes);
+        }
+        return k;
+    }
+#endif
+
+    int sobelRowDefault(const uchar*, const uchar*, const uchar*, uchar*, int begin, int, int)
+    {
+        return begin;
+    }
+
+    typedef int (*SobelRowKernel)(const uchar*, const uchar*, const uchar*, uchar*, int, int, int);
+
+    /**
+     * @brief Selects the fastest sobel kernel supported by the CPU at runtime.
+     */
+    SobelRowKernel selectSobelRowKernel()
+    {
+#ifdef SEAM_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return sobelRowAVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return sobelRowSSE41;
+#endif
+        return sobelRowDefault;
+    }
+
+    /**
+     * @brief Computes the gradients of the elements [begin, end) of row i of the image.
+     *
+     * @details The gradient is |f_x| + |f_y| saturated to uchar, computed in a single pass. The border rows
+     * and columns get the values of their inner neighbours.
+     */
+    void sobelRow(const cv::Mat& myImage, cv::Mat& Result, int i, int begin, int end)
+    {
+        static const SobelRowKernel kernel = selectSobelRowKernel();
+        const int nChannels = myImage.channels();
+        const int row = std::min(std::max(i, 1), myImage.rows - 2);
+        const uchar* previous = myImage.ptr<uchar>(row - 1);
+        const uchar* current  = myImage.ptr<uchar>(row);
+        const uchar* next     = myImage.ptr<uchar>(row + 1);
+        const int lastColumn = nChannels * (myImage.cols - 1);
+        uchar* output = Result.ptr<uchar>(i);
+
+        /* replicate the border columns */
+        int k = begin;
+        for (; k < std::min(end, nChannels); k++)
+            output[k] = sobelElement(previous, current, next, k + nChannels, nChannels);
+        const int interiorEnd = std::min(end, lastColumn);
+        k = kernel(previous, current, next, output, k, interiorEnd, nChannels);
+        for (; k < interiorEnd; k++)
+            output[k] = sobelElement(previous, current, next, k, nChannels);
+        for (; k < end; k++)
+            output[k] = sobelElement(previous, current, next, k - nChannels, nChannels);
+    }
+} // namespace
 
 void seam::sobel(const cv::Mat& myImage, cv::Mat& Result)
 {
+    SEAM_SCOPED_TIMER("energy.sobel");
     CV_Assert(myImage.depth() == CV_8U);  // accept only uchar images
-    const int nChannels = myImage.channels();
+    CV_Assert(myImage.rows >= 3 && myImage.cols >= 3);
     Result.create(myImage.size(),myImage.type());
 
-    /* compute horizontal sobel f_x */
-    for (int j = 1; j < myImage.rows-1; j++) {
-        const uchar* previous = myImage.ptr<uchar>(j - 1);
-        const uchar* next     = myImage.ptr<uchar>(j + 1);
-        uchar* output = Result.ptr<uchar>(j);
-        for (int i = nChannels; i < nChannels*(myImage.cols-1); i++) {
-            *output++ = cv::saturate_cast<uchar>(next[i-nChannels] + 2 * next[i] + next[i+nChannels]
-                    - previous[i-nChannels] - 2 * previous[i] - previous[i+nChannels]);
+    /* compute horizontal and vertical gradients and add them, the rows are independent of each other */
+    const int nElements = myImage.channels() * myImage.cols;
+    cv::parallel_for_(cv::Range(0, myImage.rows), [&](const cv::Range& rows) {
+        for (int i = rows.start; i < rows.end; i++)
+            sobelRow(myImage, Result, i, 0, nElements);
+    });
+}
+
+namespace {
+    /**
+     * @brief Computes the gradients of the elements [begin, end) of row i with the Scharr operator.
+     *
+     * @details The sum of the absolute gradients is divided by four, so the values have the same range as
+     * those of the Sobel operator. The border rows and columns get the values of their inner neighbours.
+     */
+    void scharrRow(const cv::Mat& myImage, cv::Mat& Result, int i, int begin, int end)
+    {
+        const int nChannels = myImage.channels();
+        const int row = std::min(std::max(i, 1), myImage.rows - 2);
+        const uchar* previous = myImage.ptr<uchar>(row - 1);
+        const uchar* current  = myImage.ptr<uchar>(row);
+        const uchar* next     = myImage.ptr<uchar>(row + 1);
+        const int lastColumn = nChannels * (myImage.cols - 1);
+        uchar* output = Result.ptr<uchar>(i);
+        for (int k = begin; k < end; k++) {
+            /* replicate the border columns */
+            const int c = k < nChannels ? k + nChannels : (k >= lastColumn ? k - nChannels : k);
+            const int n = nChannels;
+            const int fx = 3 * next[c-n] + 10 * next[c] + 3 * next[c+n]
+                    - 3 * previous[c-n] - 10 * previous[c] - 3 * previous[c+n];
+            const int fy = 3 * previous[c+n] + 10 * current[c+n] + 3 * next[c+n]
+                    - 3 * previous[c-n] - 10 * current[c-n] - 3 * next[c-n];
+            output[k] = static_cast<uchar>(std::min((std::abs(fx) + std::abs(fy)) / 4, static_cast<int>(UCHAR_MAX)));
         }
     }
 
-    /* set edges to neighbouring values */
-    Result.row(1).copyTo(Result.row(0));
-    Result.row(Result.rows-2).copyTo(Result.row(Result.rows-1));
-    Result.col(1).copyTo(Result.col(0));
-    Result.col(Result.cols-2).copyTo(Result.col(Result.cols-1));
+    /**
+     * @brief Computes the forward energy costs of the pixels [begin, end) of row i of a grayscale image.
+     *
+     * @details Forward energy (Rubinstein et al.) measures the new edges, which are created when the pixel is
+     * removed and its neighbours become adjacent. This depends on the pixel the seam continues with in the row
+     * above, so there are three costs per pixel, which are stored as three channels:
+     * C_L = |I(i,j+1) - I(i,j-1)| + |I(i-1,j) - I(i,j-1)|, C_U = |I(i,j+1) - I(i,j-1)| and
+     * C_R = |I(i,j+1) - I(i,j-1)| + |I(i-1,j) - I(i,j+1)|. The border pixels are replicated.
+     */
+    void forwardEnergyRow(const cv::Mat& grayscaleImage, cv::Mat& Result, int i, int begin, int end)
+    {
+        const int lastColumn = grayscaleImage.cols - 1;
+        const uchar* previous = grayscaleImage.ptr<uchar>(std::max(i - 1, 0));
+        const uchar* current = grayscaleImage.ptr<uchar>(i);
+        uchar* output = Result.ptr<uchar>(i);
+        for (int j = begin; j < end; j++) {
+            const int left = current[std::max(j - 1, 0)], right = current[std::min(j + 1, lastColumn)];
+            const int up = std::abs(right - left);
+            output[3*j]   = static_cast<uchar>(std::min(up + std::abs(previous[j] - left), static_cast<int>(UCHAR_MAX)));
+            output[3*j+1] = static_cast<uchar>(up);
+            output[3*j+2] = static_cast<uchar>(std::min(up + std::abs(previous[j] - right), static_cast<int>(UCHAR_MAX)));
+        }
+    }
 
-    /* compute vertical sobel */
-    cv::Mat ResultY;
-    ResultY.create(myImage.size(),myImage.type());
-    for(int j = 1; j < myImage.rows-1; j++) {
-        const uchar* previous = myImage.ptr<uchar>(j - 1);
-        const uchar* current = myImage.ptr<uchar>(j);
-        const uchar* next     = myImage.ptr<uchar>(j + 1);
-        uchar* output = ResultY.ptr<uchar>(j);
-        for(int i= nChannels; i < nChannels*(myImage.cols-1); ++i){
-            *output++ = cv::saturate_cast<uchar>(previous[i+nChannels] + 2 * current[i+nChannels]
-                    + next[i+nChannels] - previous[i-nChannels] - 2 * current[i-nChannels]
-                    - next[i-nChannels]);
+    /**
+     * @brief Applies the mask to the energy of the pixels [begin, end) of row i.
+     */
+    void maskRow(const cv::Mat& mask, cv::Mat& energyImage, int i, int begin, int end)
+    {
+        const int nChannels = energyImage.channels();
+        const uchar* maskRow = mask.ptr<uchar>(i);
+        uchar* energy = energyImage.ptr<uchar>(i);
+        for (int j = begin; j < end; j++) {
+            if (maskRow[j] == seam::MASK_PROTECT)
+                std::fill(energy + j * nChannels, energy + (j + 1) * nChannels, UCHAR_MAX);
+            else if (maskRow[j] == seam::MASK_REMOVE)
+                std::fill(energy + j * nChannels, energy + (j + 1) * nChannels, 0);
         }
     }
-    /* set edges to neighbouring values */
-    Result.row(1).copyTo(Result.row(0));
-    Result.row(Result.rows-2).copyTo(Result.row(Result.rows-1));
-    Result.col(1).copyTo(Result.col(0));
-    Result.col(Result.cols-2).copyTo(Result.col(Result.cols-1));
 
-    /* add vertical gradients to horizontal gradients on input image */
-    cv::add(Result, ResultY, Result);
-    ResultY.release();
+    /* Computes the energy of the columns [begin, end) of row i of a grayscale image. */
+    typedef void (*EnergyRowFunction)(const cv::Mat& grayscaleImage, cv::Mat& energyImage, int i, int begin, int end);
+
+    /**
+     * @brief The energy functions by seam::EnergyFunction and the number of channels of their energy images.
+     *
+     * @details A single channel holds a backward energy, which is the same for every direction of the seam.
+     * Three channels hold the costs of the left, upper and right predecessor. The dynamic programming is
+     * specialized for both at compile time.
+     */
+    const struct {
+        EnergyRowFunction row;
+        int channels;
+    } energyFunctions[] = {
+        { sobelRow, 1 },         // ENERGY_SOBEL
+        { scharrRow, 1 },        // ENERGY_SCHARR
+        { forwardEnergyRow, 3 }  // ENERGY_FORWARD
+    };
+
+    /**
+     * @brief Computes the energy of the columns [begin, end) of row i and applies the mask, if there is one.
+     */
+    void energyRow(seam::EnergyFunction function, const cv::Mat& grayscaleImage, const cv::Mat& mask,
+                   cv::Mat& energyImage, int i, int begin, int end)
+    {
+        energyFunctions[function].row(grayscaleImage, energyImage, i, begin, end);
+        if (!mask.empty())
+            maskRow(mask, energyImage, i, begin, end);
+    }
+} // namespace
+
+void seam::scharr(const cv::Mat& myImage, cv::Mat& Result)
+{
+    SEAM_SCOPED_TIMER("energy.scharr");
+    CV_Assert(myImage.depth() == CV_8U);  // accept only uchar images
+    CV_Assert(myImage.rows >= 3 && myImage.cols >= 3);
+    Result.create(myImage.size(),myImage.type());
+
+    const int nElements = myImage.channels() * myImage.cols;
+    cv::parallel_for_(cv::Range(0, myImage.rows), [&](const cv::Range& rows) {
+        for (int i = rows.start; i < rows.end; i++)
+            scharrRow(myImage, Result, i, 0, nElements);
+    });
 }
 
-std::vector<int> seam::seamVertical(cv::Mat& gradientImage, std::vector<std::vector<bool>>& blockedPixels)
+void seam::forwardEnergy(const cv::Mat& grayscaleImage, cv::Mat& Result)
 {
-    const int nrows = gradientImage.rows, ncols = gradientImage.cols;
-    CV_Assert(gradientImage.depth() == CV_8UC1);  // accept only uchar single channel images
-    /* create 2D vector for energy sums with additional border to prevent edge cases */
-    std::vector<std::vector<ulong>> energySum(nrows, std::vector<ulong>(ncols + 2, UINT_MAX));
-    /* initialize first row */
-    for (int i = 0; i < ncols; i++) {
-        energySum[0][i+1] = blockedPixels[0][i+1] ? UINT_MAX : gradientImage.at<uchar>(0, i);
-    }
-    /* Compute energy sum via: E[i,j] = G[i,j] + min{E[i-1,j-1], E[i-1,j], E[i-1,j-1]} */
-    for (int i = 1; i < nrows; i++) {
-        for (int j = 0; j < ncols; j++) {
-            /* mind offset for column because of border */
-            ulong energyValue = static_cast<ulong>(gradientImage.at<uchar>(i,j));
+    SEAM_SCOPED_TIMER("energy.forward");
+    CV_Assert(grayscaleImage.type() == CV_8UC1);
+    Result.create(grayscaleImage.size(), CV_8UC3);
+
+    cv::parallel_for_(cv::Range(0, grayscaleImage.rows), [&](const cv::Range& rows) {
+        for (int i = rows.start; i < rows.end; i++)
+            forwardEnergyRow(grayscaleImage, Result, i, 0, grayscaleImage.cols);
+    });
+}
+
+namespace {
+    /**
+     * @brief Converts rows of an image with CN channels of type T to 8 bit grayscale.
+     * @param scale - factor, which maps the values of the image to [0, 255].
+     */
+    template <typename T, int CN>
+    void grayscaleRows(const cv::Mat& image, cv::Mat& result, float scale)
+    {
+        /* same weights as cv::COLOR_BGR2GRAY, the alpha channel is ignored */
+        const float blue = 0.114f * scale, green = 0.587f * scale, red = 0.299f * scale;
+        cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& rows) {
+            for (int i = rows.start; i < rows.end; i++) {
+                const T* inputRow = image.ptr<T>(i);
+                uchar* outputRow = result.ptr<uchar>(i);
+                for (int j = 0; j < image.cols; j++, inputRow += CN) {
+                    const float value = CN == 1 ? inputRow[0] * scale
+                                                : inputRow[0] * blue + inputRow[1] * green + inputRow[2] * red;
+                    outputRow[j] = cv::saturate_cast<uchar>(value);
+                }
+            }
+        });
+    }
+
+    template <typename T>
+    void grayscaleRows(const cv::Mat& image, cv::Mat& result, float scale)
+    {
+        switch (image.channels()) {
+        case 1:
+            grayscaleRows<T, 1>(image, result, scale);
+            break;
+        case 3:
+            grayscaleRows<T, 3>(image, result, scale);
+            break;
+        case 4:
+            grayscaleRows<T, 4>(image, result, scale);
+            break;
+        }
+    }
+
+    /**
+     * @brief Returns the factor, which maps 1 or the largest value of a floating point image to 255.
+     */
+    float floatingPointScale(const cv::Mat& image)
+    {
+        double maxValue = 0;
+        cv::minMaxLoc(image.reshape(1), nullptr, &maxValue);
+        return static_cast<float>(255.0 / std::max(maxValue, 1.0));
+    }
+} // namespace
+
+void seam::grayscale(const cv::Mat& image, cv::Mat& result)
+{
+    const int nChannels = image.channels();
+    CV_Assert(nChannels == 1 || nChannels == 3 || nChannels == 4);
+    if (image.depth() == CV_8U) {
+        if (nChannels == 1)
+            result = image;
+        else
+            cv::cvtColor(image, result, nChannels == 3 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGRA2GRAY);
+        return;
+    }
+
+    result.create(image.size(), CV_8UC1);
+    switch (image.depth()) {
+    case CV_16U:
+        grayscaleRows<ushort>(image, result, 255.0f / 65535.0f);
+        break;
+    case CV_32F:
+        grayscaleRows<float>(image, result, floatingPointScale(image));
+        break;
+    case CV_64F:
+        grayscaleRows<double>(image, result, floatingPointScale(image));
+        break;
+    default:
+        CV_Error(cv::Error::StsUnsupportedFormat, "grayscale: unsupported depth");
+    }
+}
+
+void seam::energy(const cv::Mat& image, cv::Mat& result, EnergyFunction function, const cv::Mat& mask,
+                  bool horizontal)
+{
+    SEAM_SCOPED_TIMER("energy");
+    CV_Assert(image.rows >= 3 && image.cols >= 3);
+    CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.size() == image.size()));
+    cv::Mat grayscaleImage;
+    grayscale(image, grayscaleImage);
+
+    if (horizontal && energyFunctions[function].channels != 1) {
+        /* the costs depend on the direction, so compute them for vertical seams of the transposed image */
+        cv::Mat transposedImage, transposedMask, transposedEnergy;
+        transpose(grayscaleImage, transposedImage);
+        if (!mask.empty())
+            transpose(mask, transposedMask);
+        energy(transposedImage, transposedEnergy, function, transposedMask);
+        transpose(transposedEnergy, result);
+        return;
+    }
+
+    result.create(grayscaleImage.size(), CV_8UC(energyFunctions[function].channels));
+    cv::parallel_for_(cv::Range(0, grayscaleImage.rows), [&](const cv::Range& rows) {
+        for (int i = rows.start; i < rows.end; i++)
+            energyRow(function, grayscaleImage, mask, result, i, 0, grayscaleImage.cols);
+    });
+}
+
+namespace {
+    /**
+     * @brief Costs of a pixel with a backward energy, which are the same for all three predecessors.
+     */
+    struct BackwardCost
+    {
+        typedef BackwardCost Unmasked;
+        explicit BackwardCost(const uchar* energyRow, const uchar* = nullptr) : energy(energyRow) {}
+        uint32_t left(int j) const { return energy[j]; }
+        uint32_t up(int j) const { return energy[j]; }
+        uint32_t right(int j) const { return energy[j]; }
+        const uchar* energy;
+    };
+
+    /**
+     * @brief Costs of a pixel with forward energy, the energy image holds the cost of every predecessor.
+     */
+    struct ForwardCost
+    {
+        typedef ForwardCost Unmasked;
+        explicit ForwardCost(const uchar* energyRow, const uchar* = nullptr) : energy(energyRow) {}
+        uint32_t left(int j) const { return energy[3*j]; }
+        uint32_t up(int j) const { return energy[3*j+1]; }
+        uint32_t right(int j) const { return energy[3*j+2]; }
+        const uchar* energy;
+    };
+
+    /* Added to the cost of every pixel, which is not to be removed. A seam has one pixel per row, so this only
+     * changes the seams, if some pixels are to be removed: each of them saves the energy of many rows. */
+    const uint32_t MASK_REMOVE_BONUS = 1 << 12;
+
+    /* Added to the cost of protected pixels, so a seam only crosses them, if every other way crosses more of
+     * them. The energy sums reach BLOCKED_ENERGY only after about 16000 protected pixels. */
+    const uint32_t MASK_PROTECT_COST = 1 << 17;
+
+    /**
+     * @brief Costs of a pixel with the mask of the context, see SeamContext::setMask(), added to those of Cost.
+     *
+     * @details The 8 bit energy can't tell a protected pixel from a strong edge, so the mask is applied to the
+     * 32 bit costs of the dynamic programming instead.
+     */
+    template <typename Cost>
+    struct MaskedCost
+    {
+        typedef Cost Unmasked;
+        MaskedCost(const uchar* energyRow, const uchar* maskRow) : cost(energyRow), mask(maskRow) {}
+        uint32_t bias(int j) const
+        {
+            return mask[j] == seam::MASK_REMOVE ? 0
+                 : mask[j] == seam::MASK_PROTECT ? MASK_PROTECT_COST + MASK_REMOVE_BONUS : MASK_REMOVE_BONUS;
+        }
+        uint32_t left(int j) const { return cost.left(j) + bias(j); }
+        uint32_t up(int j) const { return cost.up(j) + bias(j); }
+        uint32_t right(int j) const { return cost.right(j) + bias(j); }
+        Cost cost;
+        const uchar* mask;
+    };
+
+    /**
+     * @brief Returns the costs of row i from column begin on, with the mask of the context.
+     */
+    template <typename Cost>
+    inline Cost rowCost(const cv::Mat& energyImage, const seam::SeamContext& context, int i, int begin = 0)
+    {
+        const uchar* mask = context.maskRow(i);
+        return Cost(energyImage.ptr<uchar>(i) + begin * energyImage.channels(), mask ? mask + begin : nullptr);
+    }
+
+    /**
+     * @brief Finds the pixel in the previous row, which continues the seam through pixel j.
+     * @param col - the column of that pixel.
+     * @return the energy sum of pixel j, if the seam continues with that pixel.
+     *
+     * @details Only the three neighbouring pixels in the previous row are considered. If the pixel above is
+     * blocked, a seam goes through it, which may come from the left or the right neighbour. Going diagonally
+     * to that side would cross the seam, so the diagonal is treated like a blocked pixel.
+     */
+    template <typename Cost>
+    inline uint32_t predecessor(const uint32_t* previousSums, const uchar* previousBlocked, const uchar* blocked,
+                                const Cost& cost, int j, int& col)
+    {
+        const uint32_t BLOCKED = seam::SeamContext::BLOCKED_ENERGY;
+        const uint32_t left = previousBlocked[j] && blocked[j-1] ? BLOCKED : previousSums[j-1] + cost.left(j);
+        const uint32_t up = previousSums[j] + cost.up(j);
+        const uint32_t right = previousBlocked[j] && blocked[j+1] ? BLOCKED : previousSums[j+1] + cost.right(j);
+        uint32_t min = left;
+        col = j - 1;
+        if (up < min) {
+            min = up;
+            col = j;
+        }
+        if (right < min) {
+            min = right;
+            col = j + 1;
+        }
+        return min;
+    }
+
+    /**
+     * @brief Computes the energy sums of the columns [begin, end) of a row from the previous row.
+     */
+    template <typename Cost>
+    void energySumRowScalar(const uint32_t* previousSums, const uchar* previousBlocked, const uchar* blocked,
+                            const Cost& cost, uint32_t* sums, int begin, int end)
+    {
+        const uint32_t BLOCKED = seam::SeamContext::BLOCKED_ENERGY;
+        int col;
+        for (int j = begin; j < end; j++) {
             /* pixel can't be used, if it is blocked or if it would cause a crossing of seams */
-            if (blockedPixels[i-1][j+1]) {
-                if (blockedPixels[i][j])
-                    energySum[i][j+1] = energyValue + energySum[i-1][j+2];
-                else if (blockedPixels[i][j+2])
-                    energySum[i][j+1] = energyValue + energySum[i-1][j];
+            if (blocked[j])
+                sums[j] = BLOCKED;
+            else
+                sums[j] = std::min(predecessor(previousSums, previousBlocked, blocked, cost, j, col), BLOCKED);
+        }
+    }
+
+#ifdef SEAM_X86_KERNELS
+    /* The vector kernels compute the same as predecessor() for several columns at once. The blocked masks are
+     * widened to one lane per column and select BLOCKED_ENERGY instead of branching. */
+
+    __attribute__((target("sse4.1")))
+    inline __m128i loadMask4(const uchar* blocked)
+    {
+        int32_t bytes;
+        std::memcpy(&bytes, blocked, sizeof(bytes));
+        return _mm_cmpgt_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)), _mm_setzero_si128());
+    }
+
+    __attribute__((target("sse4.1")))
+    void energySumRowSSE41(const uint32_t* previousSums, const uchar* previousBlocked, const uchar* blocked,
+                           const uchar* energy, uint32_t* sums, int ncols)
+    {
+        const __m128i BLOCKED = _mm_set1_epi32(seam::SeamContext::BLOCKED_ENERGY);
+        int j = 0;
+        for (; j + 4 <= ncols; j += 4) {
+            const __m128i above = loadMask4(previousBlocked + j);
+            const __m128i left = _mm_blendv_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousSums + j - 1)),
+                                                 BLOCKED, _mm_and_si128(above, loadMask4(blocked + j - 1)));
+            const __m128i right = _mm_blendv_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousSums + j + 1)),
+                                                  BLOCKED, _mm_and_si128(above, loadMask4(blocked + j + 1)));
+            const __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previousSums + j));
+            int32_t bytes;
+            std::memcpy(&bytes, energy + j, sizeof(bytes));
+            __m128i sum = _mm_add_epi32(_mm_min_epu32(_mm_min_epu32(left, up), right),
+                                        _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)));
+            sum = _mm_blendv_epi8(_mm_min_epu32(sum, BLOCKED), BLOCKED, loadMask4(blocked + j));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + j), sum);
+        }
+        energySumRowScalar(previousSums, previousBlocked, blocked, BackwardCost(energy), sums, j, ncols);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i loadMask8(const uchar* blocked)
+    {
+        const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(blocked));
+        return _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(bytes), _mm256_setzero_si256());
+    }
+
+    __attribute__((target("avx2")))
+    void energySumRowAVX2(const uint32_t* previousSums, const uchar* previousBlocked, const uchar* blocked,
+                          const uchar* energy, uint32_t* sums, int ncols)
+    {
+        const __m256i BLOCKED = _mm256_set1_epi32(seam::SeamContext::BLOCKED_ENERGY);
+        int j = 0;
+        for (; j + 8 <= ncols; j += 8) {
+            const __m256i above = loadMask8(previousBlocked + j);
+            const __m256i left = _mm256_blendv_epi8(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previousSums + j - 1)),
+                        BLOCKED, _mm256_and_si256(above, loadMask8(blocked + j - 1)));
+            const __m256i right = _mm256_blendv_epi8(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previousSums + j + 1)),
+                        BLOCKED, _mm256_and_si256(above, loadMask8(blocked + j + 1)));
+            const __m256i up = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previousSums + j));
+            const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(energy + j));
+            __m256i sum = _mm256_add_epi32(_mm256_min_epu32(_mm256_min_epu32(left, up), right),
+                                           _mm256_cvtepu8_epi32(bytes));
+            sum = _mm256_blendv_epi8(_mm256_min_epu32(sum, BLOCKED), BLOCKED, loadMask8(blocked + j));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + j), sum);
+        }
+        energySumRowScalar(previousSums, previousBlocked, blocked, BackwardCost(energy), sums, j, ncols);
+    }
+#endif
+
+    void energySumRowDefault(const uint32_t* previousSums, const uchar* previousBlocked, const uchar* blocked,
+                             const uchar* energy, uint32_t* sums, int ncols)
+    {
+        energySumRowScalar(previousSums, previousBlocked, blocked, BackwardCost(energy), sums, 0, ncols);
+    }
+
+    typedef void (*EnergySumRowKernel)(const uint32_t*, const uchar*, const uchar*, const uchar*, uint32_t*, int);
+
+    /**
+     * @brief Selects the fastest row kernel supported by the CPU at runtime.
+     */
+    EnergySumRowKernel selectEnergySumRowKernel()
+    {
+#ifdef SEAM_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return energySumRowAVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return energySumRowSSE41;
+#endif
+        return energySumRowDefault;
+    }
+
+    /**
+     * @brief Computes the first row of the energy sums, which are just the costs of the pixels.
+     */
+    template <typename Cost>
+    void firstEnergySumRow(seam::SeamContext& context, const Cost& cost)
+    {
+        uint32_t* sums = context.energyRow(0);
+        const uchar* blocked = context.blockedRow(0);
+        for (int j = 0; j < context.cols(); j++)
+            sums[j] = blocked[j] ? seam::SeamContext::BLOCKED_ENERGY : cost.up(j);
+    }
+
+    /**
+     * @brief Computes the energy sums of the columns [0, ncols) of a row from the previous row via:
+     * E[i,j] = min{E[i-1,j-1] + C_L, E[i-1,j] + C_U, E[i-1,j+1] + C_R}
+     * The previous row has to be readable at -1 and ncols.
+     */
+    template <typename Cost>
+    void energySumSpan(const uint32_t* previousSums, const uchar* previousBlocked, const uchar* blocked,
+                       const Cost& cost, uint32_t* sums, int ncols)
+    {
+        energySumRowScalar(previousSums, previousBlocked, blocked, cost, sums, 0, ncols);
+    }
+
+    /**
+     * @brief Same for a backward energy, where all costs equal the energy value G[i,j]:
+     * E[i,j] = G[i,j] + min{E[i-1,j-1], E[i-1,j], E[i-1,j+1]}
+     */
+    void energySumSpan(const uint32_t* previousSums, const uchar* previousBlocked, const uchar* blocked,
+                       const BackwardCost& cost, uint32_t* sums, int ncols)
+    {
+        static const EnergySumRowKernel kernel = selectEnergySumRowKernel();
+        kernel(previousSums, previousBlocked, blocked, cost.energy, sums, ncols);
+    }
+
+    /**
+     * @brief Computes row i of the energy sums.
+     */
+    template <typename Cost>
+    void energySumRow(seam::SeamContext& context, int i, const Cost& cost)
+    {
+        if (i == 0)
+            firstEnergySumRow(context, cost);
+        else
+            energySumSpan(context.energyRow(i-1), context.blockedRow(i-1), context.blockedRow(i), cost,
+                          context.energyRow(i), context.cols());
+    }
+
+    /* rows narrower than two stripes of this width are computed by one thread */
+    const int MIN_STRIPE_WIDTH = 2048;
+
+    /* rows computed by the stripes between two synchronizations */
+    const int STRIPE_BLOCK_ROWS = 64;
+
+    /**
+     * @brief Computes all energy sums with the columns split into stripes, which are computed in parallel.
+     *
+     * @details Row i of a stripe depends on row i - 1 of the stripe and one column of each neighbour. Instead of
+     * waiting for the neighbours in every row, the stripes are only synchronized after blocks of
+     * STRIPE_BLOCK_ROWS rows: within a block, every stripe also computes a halo of the columns of its neighbours,
+     * which shrinks by one column per row, so that the last row of the block doesn't need any of them. The
+     * halo is kept in two private rows per stripe and only the own columns are copied to the context, so the
+     * energy sums equal the ones of energySumRow(). The blocks run on the thread pool of OpenCV, which is reused
+     * for all blocks and seams, and the stripes never wait for each other within a block.
+     */
+    template <typename Cost>
+    void stripedEnergySums(const cv::Mat& energyImage, seam::SeamContext& context, int nstripes)
+    {
+        const uint32_t BLOCKED = seam::SeamContext::BLOCKED_ENERGY;
+        const int nrows = context.rows(), ncols = context.cols();
+        const int halo = STRIPE_BLOCK_ROWS;
+        /* a private row covers the stripe, the halo and the border column on either side */
+        const size_t rowLength = ncols / nstripes + 1 + 2 * halo + 2;
+        uint32_t* stripeRows = context.stripeRows(2 * nstripes * rowLength);
+
+        for (int blockBegin = 0; blockBegin < nrows; blockBegin += STRIPE_BLOCK_ROWS) {
+            const int blockEnd = std::min(blockBegin + STRIPE_BLOCK_ROWS, nrows);
+            cv::parallel_for_(cv::Range(0, nstripes), [&](const cv::Range& stripes) {
+                for (int s = stripes.start; s < stripes.end; s++) {
+                    const int stripeBegin = static_cast<int>(static_cast<int64_t>(ncols) * s / nstripes);
+                    const int stripeEnd = static_cast<int>(static_cast<int64_t>(ncols) * (s + 1) / nstripes);
+                    /* column of the first entry of the private rows */
+                    const int base = stripeBegin - halo - 1;
+                    uint32_t* previousRow = stripeRows + 2 * s * rowLength;
+                    uint32_t* row = previousRow + rowLength;
+                    for (int i = blockBegin; i < blockEnd; i++) {
+                        const int width = blockEnd - 1 - i;
+                        const int begin = std::max(stripeBegin - width, 0), end = std::min(stripeEnd + width, ncols);
+                        const Cost cost = rowCost<Cost>(energyImage, context, i, begin);
+                        const uchar* blocked = context.blockedRow(i) + begin;
+                        uint32_t* sums = row + (begin - base);
+                        if (i == 0) {
+                            for (int j = 0; j < end - begin; j++)
+                                sums[j] = blocked[j] ? BLOCKED : cost.up(j);
+                        } else {
+                            /* the first row of a block reads the previous block from the context */
+                            const uint32_t* previousSums = i == blockBegin ? context.energyRow(i-1) + begin
+                                                                           : previousRow + (begin - base);
+                            energySumSpan(previousSums, context.blockedRow(i-1) + begin, blocked, cost, sums,
+                                          end - begin);
+                        }
+                        /* the borders of the image, which the next row reads */
+                        if (begin == 0)
+                            sums[-1] = BLOCKED;
+                        if (end == ncols)
+                            sums[end - begin] = BLOCKED;
+                        std::copy(row + (stripeBegin - base), row + (stripeEnd - base),
+                                  context.energyRow(i) + stripeBegin);
+                        std::swap(previousRow, row);
+                    }
+                }
+            });
+        }
+    }
+
+    /**
+     * @brief Computes all energy sums, in parallel stripes for wide images.
+     */
+    template <typename Cost>
+    void energySums(const cv::Mat& energyImage, seam::SeamContext& context)
+    {
+        SEAM_SCOPED_TIMER("seam.dp");
+        const int nstripes = std::min(cv::getNumThreads(), context.cols() / MIN_STRIPE_WIDTH);
+        if (nstripes > 1) {
+            stripedEnergySums<Cost>(energyImage, context, nstripes);
+            return;
+        }
+        for (int i = 0; i < energyImage.rows; i++)
+            energySumRow(context, i, rowCost<Cost>(energyImage, context, i));
+    }
+
+    /**
+     * @brief Backtracks the seam with the lowest energy sum, which ends in the columns [begin, end) of the last row.
+     * @return false, if all pixels are blocked.
+     */
+    template <typename Cost>
+    bool backtrackSeam(seam::SeamContext& context, const cv::Mat& energyImage, std::vector<int>& result,
+                       int begin = 0, int end = -1)
+    {
+        const int nrows = context.rows();
+        const uint32_t* lastRow = context.energyRow(nrows-1);
+        int col = std::min_element(lastRow + begin, lastRow + (end < 0 ? context.cols() : end)) - lastRow;
+        if (lastRow[col] >= seam::SeamContext::BLOCKED_ENERGY) /* all pixels are blocked, seams can't be computed. */
+            return false;
+
+        result.resize(nrows);
+        result[nrows-1] = col;
+        for (int i = nrows-1; i > 0; i--) {
+            /* find next column index: I[i-1] = argmin{E[i-1,j-1] + C_L, E[i-1,j] + C_U, E[i-1,j+1] + C_R} */
+            predecessor(context.energyRow(i-1), context.blockedRow(i-1), context.blockedRow(i),
+                        rowCost<Cost>(energyImage, context, i), result[i], col);
+            result[i-1] = col;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Recomputes the energy sums of the columns [begin, end) of row i.
+     * @param changedBegin, changedEnd - the range of columns, whose energy sums changed.
+     */
+    template <typename Cost>
+    void updateEnergySumRow(seam::SeamContext& context, int i, const Cost& cost, int begin, int end,
+                            int& changedBegin, int& changedEnd)
+    {
+        const uint32_t BLOCKED = seam::SeamContext::BLOCKED_ENERGY;
+        uint32_t* sums = context.energyRow(i);
+        const uchar* blocked = context.blockedRow(i);
+        changedBegin = end;
+        changedEnd = begin;
+        int col;
+        for (int j = begin; j < end; j++) {
+            const uint32_t sum = blocked[j] ? BLOCKED : i == 0 ? cost.up(j) : std::min(predecessor(
+                    context.energyRow(i-1), context.blockedRow(i-1), blocked, cost, j, col), BLOCKED);
+            if (sum != sums[j]) {
+                sums[j] = sum;
+                changedBegin = std::min(changedBegin, j);
+                changedEnd = j + 1;
+            }
+        }
+    }
+
+    /**
+     * @brief Updates the energy sums after the pixels of a vertical seam were blocked.
+     *
+     * @details Blocking a pixel changes its own energy sum and, because seams may not cross, the ones of its left
+     * and right neighbour and of the pixels below it. Every other energy sum only changes, if one of the three
+     * energy sums above it did, so like after removing a seam the range of changed energy sums is tracked from
+     * row to row, and only the cone below the seam is recomputed.
+     */
+    template <typename Cost>
+    void updateAfterBlocking(const cv::Mat& energyImage, seam::SeamContext& context, const std::vector<int>& seam)
+    {
+        SEAM_SCOPED_TIMER("seam.update");
+        const int nrows = context.rows(), ncols = context.cols();
+        int changedBegin = 0, changedEnd = 0;
+        for (int i = 0; i < nrows; i++) {
+            const int above = i > 0 ? seam[i-1] : seam[i];
+            int begin = std::max(std::min(seam[i], above) - 1, 0), end = std::min(std::max(seam[i], above) + 2, ncols);
+            if (changedBegin < changedEnd) {
+                begin = std::min(begin, std::max(changedBegin - 1, 0));
+                end = std::max(end, std::min(changedEnd + 1, ncols));
+            }
+            SEAM_COUNT("sums_updated", end - begin);
+            updateEnergySumRow(context, i, rowCost<Cost>(energyImage, context, i), begin, end, changedBegin,
+                               changedEnd);
+        }
+    }
+
+    /**
+     * @brief Computes all energy sums and backtracks the seam with the lowest energy sum.
+     */
+    template <typename Cost>
+    bool computeSeam(const cv::Mat& energyImage, seam::SeamContext& context, std::vector<int>& result)
+    {
+        energySums<Cost>(energyImage, context);
+        SEAM_SCOPED_TIMER("seam.backtrack");
+        return backtrackSeam<Cost>(context, energyImage, result);
+    }
+
+    /**
+     * @brief Backtracks the seam with the lowest energy sum and computes all energy sums first, unless the
+     * context still has the ones of the energy image.
+     */
+    template <typename Cost>
+    bool nextSeam(const cv::Mat& energyImage, seam::SeamContext& context, std::vector<int>& result)
+    {
+        if (context.energySource() != energyImage.data) {
+            const bool found = computeSeam<Cost>(energyImage, context, result);
+            context.setEnergySource(energyImage.data);
+            return found;
+        }
+        SEAM_SCOPED_TIMER("seam.backtrack");
+        return backtrackSeam<Cost>(context, energyImage, result);
+    }
+} // namespace
+
+namespace {
+    /**
+     * @brief Computes the energy sums only in the columns [begin, end) of every row, which columns(i, begin, end)
+     * returns, and backtracks the seam with the lowest energy sum inside them.
+     * @return false, if the blocked pixels leave no seam inside the columns.
+     *
+     * @details The energy sums of the previous row just outside its columns are stale, so they are set to
+     * BLOCKED_ENERGY before they are read. The seam can't leave the columns, and the cost per row only depends
+     * on their number.
+     */
+    template <typename Cost, typename Columns>
+    bool limitedSeam(const cv::Mat& energyImage, seam::SeamContext& context, Columns columns,
+                     std::vector<int>& result)
+    {
+        const uint32_t BLOCKED = seam::SeamContext::BLOCKED_ENERGY;
+        const int nrows = energyImage.rows;
+        int previousBegin = 0, previousEnd = 0, begin = 0, end = 0;
+        for (int i = 0; i < nrows; i++) {
+            const Cost cost = rowCost<Cost>(energyImage, context, i);
+            columns(i, begin, end);
+            uint32_t* sums = context.energyRow(i);
+            const uchar* blocked = context.blockedRow(i);
+            if (i == 0) {
+                for (int j = begin; j < end; j++)
+                    sums[j] = blocked[j] ? BLOCKED : cost.up(j);
             } else {
-                energySum[i][j+1] = blockedPixels[i][j+1] ? UINT_MAX : energyValue + std::min(energySum[i-1][j],
-                        std::min(energySum[i-1][j+1], energySum[i-1][j+2]));
-            }
-        }
-    }
-    /* backtrack the seam with the lowest energy sum and set seam to UCHAR_MAX on gradient image */
-    std::vector<int> result(nrows);
-    std::vector<ulong> lastRow = energySum[nrows-1];
-    uint col = std::min_element(lastRow.begin(), lastRow.end()) - lastRow.begin(); // start column index
-    gradientImage.at<uchar>(nrows-1, col-1) = UCHAR_MAX;
-    /* block pixel of seam and the two neighbours to the left and right to prevent crossing */
-    blockedPixels[nrows-1][col] = true;
-    result[nrows-1] = col - 1;
-    if (col == 0) /* all pixels are blocked, seams can't be computed. */
-        return std::vector<int>();
-
-    for (int i = nrows-2; i >= 0; i--) {
-        /* find next column index: I[i,j] = argmin{I[i+1,j-1], I[i+1,j], I[i+1, j+1]} and
-            delete seam by setting it on high values. */
-        std::vector<ulong>* row = &energySum[i];
-        col = std::min_element(row->begin() + col - 1, row->begin() + col + 2)
-                - row->begin();
-        if (col == 0) /* all pixels are blocked, seams can't be computed. */
-            return std::vector<int>();
-
-        gradientImage.at<uchar>(i,col-1) = UCHAR_MAX;
-        /* block pixel of seam and the two neighbours to the left and right to prevent crossing */
-        blockedPixels[i][col] = true;
-        result[i] = col - 1;
+                uint32_t* previousSums = context.energyRow(i-1);
+                for (int j = begin - 1; j < std::min(previousBegin, end + 1); j++)
+                    previousSums[j] = BLOCKED;
+                for (int j = std::max(previousEnd, begin - 1); j <= end; j++)
+                    previousSums[j] = BLOCKED;
+                energySumRowScalar(previousSums, context.blockedRow(i-1), blocked, cost, sums, begin, end);
+            }
+            previousBegin = begin;
+            previousEnd = end;
+        }
+        return backtrackSeam<Cost>(context, energyImage, result, begin, end);
+    }
+
+    /**
+     * @brief Computes the energy sums only in a corridor around the seam of the next coarser level and backtracks
+     * the seam with the lowest energy sum inside it.
+     * @param coarseSeam - a seam of the image with the rows and columns divided by 2^shift, see SeamPyramid,
+     *        or with shift 0 a seam of an image of the same size, e.g. of the previous frame of a video.
+     * @param corridor - the number of columns on either side of the coarse seam.
+     * @return false, if the blocked pixels leave no seam inside the corridor.
+     *
+     * @details The corridor of row i are the 2^shift columns covered by pixel coarseSeam[i >> shift] and corridor
+     * columns on either side, see limitedSeam(). The cost per row doesn't depend on the width of the image.
+     */
+    template <typename Cost>
+    bool corridorSeam(const cv::Mat& energyImage, seam::SeamContext& context, const std::vector<int>& coarseSeam,
+                      int corridor, int shift, std::vector<int>& result)
+    {
+        const int ncols = energyImage.cols;
+        return limitedSeam<Cost>(energyImage, context, [&](int i, int& begin, int& end) {
+            begin = std::max((coarseSeam[i >> shift] << shift) - corridor, 0);
+            end = std::min((coarseSeam[i >> shift] << shift) + (1 << shift) + corridor, ncols);
+        }, result);
+    }
+
+    /**
+     * @brief Computes the energy sums only in the cone below column start of the first row, which is the only
+     * pixel a seam may start with, and backtracks the seam with the lowest energy sum inside it.
+     * @param limit - the cone is cut off at this column.
+     * @return false, if the blocked pixels leave no seam, which starts in column start.
+     *
+     * @details Row i of the cone are the columns within i of start, see limitedSeam(), so the cost of a seam
+     * through n rows is about n^2 instead of n times the width of the image.
+     */
+    template <typename Cost>
+    bool coneSeam(const cv::Mat& energyImage, seam::SeamContext& context, int start, int limit,
+                  std::vector<int>& result)
+    {
+        return limitedSeam<Cost>(energyImage, context, [&](int i, int& begin, int& end) {
+            begin = std::max(start - i, 0);
+            end = std::min(start + i + 1, limit);
+        }, result);
+    }
+
+    /**
+     * @brief Computes the seam on the coarsest level of the pyramid and refines it level by level. Only the full
+     * resolution has the mask of the context.
+     */
+    template <typename Cost>
+    bool pyramidSeam(const cv::Mat& energyImage, seam::SeamContext& context, seam::SeamPyramid& pyramid,
+                     std::vector<int>& result)
+    {
+        typedef typename Cost::Unmasked LevelCost;
+        std::vector<int> coarseSeam;
+        {
+            SEAM_SCOPED_TIMER("pyramid.coarse");
+            const int coarsest = pyramid.levels() - 1;
+            bool found = computeSeam<LevelCost>(pyramid.level(coarsest), pyramid.context(coarsest), coarseSeam);
+            for (int l = coarsest - 1; found && l >= 0; l--) {
+                found = corridorSeam<LevelCost>(pyramid.level(l), pyramid.context(l), coarseSeam,
+                                                pyramid.corridor(), 1, result);
+                coarseSeam.swap(result);
+            }
+            if (found) {
+                SEAM_SCOPED_TIMER("pyramid.refine");
+                if (corridorSeam<Cost>(energyImage, context, coarseSeam, pyramid.corridor(), 1, result))
+                    return true;
+            }
+        }
+        /* earlier seams block the coarse levels or the corridor */
+        SEAM_COUNT("pyramid_fallbacks", 1);
+        return computeSeam<Cost>(energyImage, context, result);
+    }
+
+    /**
+     * @brief Same as seam::seamVertical() with a pyramid, which was already built for the gradient image.
+     */
+    bool pyramidSeamVertical(cv::Mat& gradientImage, seam::SeamContext& context, seam::SeamPyramid& pyramid,
+                             std::vector<int>& result)
+    {
+        if (pyramid.levels() == 0)
+            return seam::seamVertical(gradientImage, context, result);
+        const int nrows = gradientImage.rows, nChannels = gradientImage.channels();
+        result.clear();
+
+        bool found;
+        if (context.hasMask())
+            found = nChannels == 1 ? pyramidSeam<MaskedCost<BackwardCost>>(gradientImage, context, pyramid, result)
+                                   : pyramidSeam<MaskedCost<ForwardCost>>(gradientImage, context, pyramid, result);
+        else
+            found = nChannels == 1 ? pyramidSeam<BackwardCost>(gradientImage, context, pyramid, result)
+                                   : pyramidSeam<ForwardCost>(gradientImage, context, pyramid, result);
+        if (!found) {
+            SEAM_COUNT("seams_blocked", 1);
+            return false;
+        }
+        SEAM_COUNT("seams_computed", 1);
+
+        /* block pixels of seam and mark it on the gradient image and on all levels */
+        for (int i = 0; i < nrows; i++) {
+            context.block(i, result[i]);
+            uchar* pixel = gradientImage.ptr<uchar>(i) + result[i] * nChannels;
+            std::fill(pixel, pixel + nChannels, UCHAR_MAX);
+        }
+        pyramid.markSeam(result);
+        return true;
+    }
+} // namespace
+
+namespace {
+    /**
+     * @brief Searches the seam inside the corridor around the guide, or in the full image, if it is blocked.
+     */
+    template <typename Cost>
+    bool guidedSeam(const cv::Mat& energyImage, seam::SeamContext& context, const std::vector<int>& guide,
+                    int corridor, std::vector<int>& result)
+    {
+        /* the corridor overwrites some of the energy sums, so they can't be updated for the next seam */
+        context.setEnergySource(nullptr);
+        {
+            SEAM_SCOPED_TIMER("seam.guided");
+            if (corridorSeam<Cost>(energyImage, context, guide, corridor, 0, result))
+                return true;
+        }
+        /* earlier seams block the corridor */
+        SEAM_COUNT("guide_fallbacks", 1);
+        return computeSeam<Cost>(energyImage, context, result);
+    }
+} // namespace
+
+bool seam::seamVertical(cv::Mat& gradientImage, SeamContext& context, const std::vector<int>& guide, int corridor,
+                        std::vector<int>& result)
+{
+    const int nrows = gradientImage.rows, nChannels = gradientImage.channels();
+    CV_Assert(gradientImage.type() == CV_8UC1 || gradientImage.type() == CV_8UC3);  // backward or forward energy
+    CV_Assert(context.rows() == nrows && context.cols() == gradientImage.cols);
+    CV_Assert(static_cast<int>(guide.size()) == nrows && corridor >= 0);
+    result.clear();
+
+    bool found;
+    if (context.hasMask())
+        found = nChannels == 1 ? guidedSeam<MaskedCost<BackwardCost>>(gradientImage, context, guide, corridor, result)
+                               : guidedSeam<MaskedCost<ForwardCost>>(gradientImage, context, guide, corridor, result);
+    else
+        found = nChannels == 1 ? guidedSeam<BackwardCost>(gradientImage, context, guide, corridor, result)
+                               : guidedSeam<ForwardCost>(gradientImage, context, guide, corridor, result);
+    if (!found) {
+        SEAM_COUNT("seams_blocked", 1);
+        return false;
+    }
+    SEAM_COUNT("seams_computed", 1);
+
+    /* block pixels of seam and mark it on the gradient image, the energy sums of the corridor are discarded */
+    for (int i = 0; i < nrows; i++) {
+        context.block(i, result[i]);
+        uchar* pixel = gradientImage.ptr<uchar>(i) + result[i] * nChannels;
+        std::fill(pixel, pixel + nChannels, UCHAR_MAX);
+    }
+    return true;
+}
+
+bool seam::seamHorizontal(cv::Mat& gradientImage, SeamContext& context, const std::vector<int>& guide, int corridor,
+                          std::vector<int>& result)
+{
+    const int ncols = gradientImage.cols, nChannels = gradientImage.channels();
+    CV_Assert(gradientImage.type() == CV_8UC1 || gradientImage.type() == CV_8UC3);  // backward or forward energy
+    CV_Assert(context.rows() == ncols && context.cols() == gradientImage.rows);
+
+    cv::Mat& transposed = context.transposedImage();
+    if (context.transposedSource() != gradientImage.data) {
+        SEAM_SCOPED_TIMER("seam.transpose");
+        transpose(gradientImage, transposed);
+        context.setTransposedSource(gradientImage.data);
+    }
+    /* the guide is a vertical seam of the transposed image */
+    if (!seamVertical(transposed, context, guide, corridor, result))
+        return false;
+
+    for (int j = 0; j < ncols; j++) {
+        uchar* pixel = gradientImage.ptr<uchar>(result[j]) + j * nChannels;
+        std::fill(pixel, pixel + nChannels, UCHAR_MAX);
+    }
+    return true;
+}
+
+bool seam::seamVertical(cv::Mat& gradientImage, SeamContext& context, int start, int limit,
+                        std::vector<int>& result)
+{
+    const int nrows = gradientImage.rows, nChannels = gradientImage.channels();
+    CV_Assert(gradientImage.type() == CV_8UC1 || gradientImage.type() == CV_8UC3);  // backward or forward energy
+    CV_Assert(context.rows() == nrows && context.cols() == gradientImage.cols);
+    CV_Assert(start >= 0 && start < limit && limit <= gradientImage.cols);
+    result.clear();
+
+    /* the cone overwrites some of the energy sums, so they can't be updated for the next seam */
+    context.setEnergySource(nullptr);
+    bool found;
+    {
+        SEAM_SCOPED_TIMER("seam.cone");
+        if (context.hasMask())
+            found = nChannels == 1 ? coneSeam<MaskedCost<BackwardCost>>(gradientImage, context, start, limit, result)
+                                   : coneSeam<MaskedCost<ForwardCost>>(gradientImage, context, start, limit, result);
+        else
+            found = nChannels == 1 ? coneSeam<BackwardCost>(gradientImage, context, start, limit, result)
+                                   : coneSeam<ForwardCost>(gradientImage, context, start, limit, result);
+    }
+    if (!found) {
+        SEAM_COUNT("seams_blocked", 1);
+        return false;
+    }
+    SEAM_COUNT("seams_computed", 1);
+
+    for (int i = 0; i < nrows; i++) {
+        context.block(i, result[i]);
+        uchar* pixel = gradientImage.ptr<uchar>(i) + result[i] * nChannels;
+        std::fill(pixel, pixel + nChannels, UCHAR_MAX);
     }
+    return true;
+}
+
+bool seam::seamVertical(cv::Mat& gradientImage, SeamContext& context, SeamPyramid& pyramid,
+                        std::vector<int>& result)
+{
+    CV_Assert(gradientImage.type() == CV_8UC1 || gradientImage.type() == CV_8UC3);  // backward or forward energy
+    CV_Assert(context.rows() == gradientImage.rows && context.cols() == gradientImage.cols);
+    if (pyramid.source() != gradientImage.data)
+        pyramid.build(gradientImage);
+    return pyramidSeamVertical(gradientImage, context, pyramid, result);
+}
+
+bool seam::seamHorizontal(cv::Mat& gradientImage, SeamContext& context, SeamPyramid& pyramid,
+                          std::vector<int>& result)
+{
+    const int ncols = gradientImage.cols, nChannels = gradientImage.channels();
+    CV_Assert(gradientImage.type() == CV_8UC1 || gradientImage.type() == CV_8UC3);  // backward or forward energy
+    CV_Assert(context.rows() == ncols && context.cols() == gradientImage.rows);
+
+    cv::Mat& transposed = context.transposedImage();
+    if (context.transposedSource() != gradientImage.data) {
+        SEAM_SCOPED_TIMER("seam.transpose");
+        transpose(gradientImage, transposed);
+        context.setTransposedSource(gradientImage.data);
+    }
+    /* the levels are built from the transposed image, but belong to the gradient image */
+    if (pyramid.source() != gradientImage.data) {
+        pyramid.build(transposed);
+        pyramid.setSource(gradientImage.data);
+    }
+    if (!pyramidSeamVertical(transposed, context, pyramid, result))
+        return false;
+
+    for (int j = 0; j < ncols; j++) {
+        uchar* pixel = gradientImage.ptr<uchar>(result[j]) + j * nChannels;
+        std::fill(pixel, pixel + nChannels, UCHAR_MAX);
+    }
+    return true;
+}
+
+bool seam::seamVertical(cv::Mat& gradientImage, SeamContext& context, std::vector<int>& result, uint32_t* cost)
+{
+    const int nrows = gradientImage.rows, nChannels = gradientImage.channels();
+    CV_Assert(gradientImage.type() == CV_8UC1 || gradientImage.type() == CV_8UC3);  // backward or forward energy
+    CV_Assert(context.rows() == nrows && context.cols() == gradientImage.cols);
+    result.clear();
+
+    bool found;
+    if (context.hasMask())
+        found = nChannels == 1 ? nextSeam<MaskedCost<BackwardCost>>(gradientImage, context, result)
+                               : nextSeam<MaskedCost<ForwardCost>>(gradientImage, context, result);
+    else
+        found = nChannels == 1 ? nextSeam<BackwardCost>(gradientImage, context, result)
+                               : nextSeam<ForwardCost>(gradientImage, context, result);
+    if (!found) {
+        SEAM_COUNT("seams_blocked", 1);
+        return false;
+    }
+    SEAM_COUNT("seams_computed", 1);
+    /* blocking the seam overwrites its energy sums, so the one of the last row is read first */
+    if (cost)
+        *cost = context.energyRow(nrows - 1)[result.back()];
+
+    /* block pixels of seam to prevent crossing and set seam to UCHAR_MAX on gradient image */
+    for (int i = 0; i < nrows; i++) {
+        context.block(i, result[i]);
+        uchar* pixel = gradientImage.ptr<uchar>(i) + result[i] * nChannels;
+        std::fill(pixel, pixel + nChannels, UCHAR_MAX);
+    }
+    /* the energy of the blocked pixels doesn't matter, so the energy sums stay valid for the next seam */
+    if (context.hasMask() && nChannels == 1)
+        updateAfterBlocking<MaskedCost<BackwardCost>>(gradientImage, context, result);
+    else if (context.hasMask())
+        updateAfterBlocking<MaskedCost<ForwardCost>>(gradientImage, context, result);
+    else if (nChannels == 1)
+        updateAfterBlocking<BackwardCost>(gradientImage, context, result);
+    else
+        updateAfterBlocking<ForwardCost>(gradientImage, context, result);
+    context.setEnergySource(gradientImage.data);
+    return true;
+}
+
+bool seam::seamHorizontal(cv::Mat& gradientImage, SeamContext& context, std::vector<int>& result, uint32_t* cost)
+{
+    const int ncols = gradientImage.cols, nChannels = gradientImage.channels();
+    CV_Assert(gradientImage.type() == CV_8UC1 || gradientImage.type() == CV_8UC3);  // backward or forward energy
+    CV_Assert(context.rows() == ncols && context.cols() == gradientImage.rows);
+
+    /* every column of the image is a row of the transposed image, so the seam is a vertical seam there */
+    cv::Mat& transposed = context.transposedImage();
+    if (context.transposedSource() != gradientImage.data) {
+        SEAM_SCOPED_TIMER("seam.transpose");
+        transpose(gradientImage, transposed);
+        context.setTransposedSource(gradientImage.data);
+    }
+    /* marks the seam on the transposed image, so it stays equal to the gradient image */
+    if (!seamVertical(transposed, context, result, cost))
+        return false;
+
+    /* set seam to UCHAR_MAX on gradient image */
+    for (int j = 0; j < ncols; j++) {
+        uchar* pixel = gradientImage.ptr<uchar>(result[j]) + j * nChannels;
+        std::fill(pixel, pixel + nChannels, UCHAR_MAX);
+    }
+    return true;
+}
+
+namespace {
+    /* edge length of the blocks, which are transposed directly */
+    const int TRANSPOSE_BLOCK = 32;
+
+    /* pixel with N bytes, for pixel sizes without a matching integer type */
+    template <int N>
+    struct Element {
+        uint8_t bytes[N];
+    };
+
+    template <typename T>
+    void transposeBlock(const cv::Mat& input, cv::Mat& output, int row, int col, int nrows, int ncols)
+    {
+        if (nrows > TRANSPOSE_BLOCK || ncols > TRANSPOSE_BLOCK) {
+            /* split along the larger side */
+            if (nrows >= ncols) {
+                transposeBlock<T>(input, output, row, col, nrows / 2, ncols);
+                transposeBlock<T>(input, output, row + nrows / 2, col, nrows - nrows / 2, ncols);
+            } else {
+                transposeBlock<T>(input, output, row, col, nrows, ncols / 2);
+                transposeBlock<T>(input, output, row, col + ncols / 2, nrows, ncols - ncols / 2);
+            }
+            return;
+        }
+        /* the block of the input is in the cache, so write the output rows contiguously */
+        const size_t inputStep = input.step / sizeof(T);
+        for (int j = col; j < col + ncols; j++) {
+            const T* inputCol = input.ptr<T>(row) + j;
+            T* outputRow = output.ptr<T>(j);
+            for (int i = row; i < row + nrows; i++, inputCol += inputStep)
+                outputRow[i] = *inputCol;
+        }
+    }
+} // namespace
+
+void seam::transpose(const cv::Mat& input, cv::Mat& output)
+{
+    SEAM_SCOPED_TIMER("transpose");
+    CV_Assert(input.data != output.data || input.empty());
+    output.create(input.cols, input.rows, input.type());
+    SEAM_COUNT("bytes_copied", input.total() * input.elemSize());
+    switch (input.elemSize()) {
+    case 1:
+        transposeBlock<uint8_t>(input, output, 0, 0, input.rows, input.cols);
+        break;
+    case 2:
+        transposeBlock<uint16_t>(input, output, 0, 0, input.rows, input.cols);
+        break;
+    case 4:
+        transposeBlock<uint32_t>(input, output, 0, 0, input.rows, input.cols);
+        break;
+    case 8:
+        transposeBlock<uint64_t>(input, output, 0, 0, input.rows, input.cols);
+        break;
+    case 3:
+        transposeBlock<Element<3>>(input, output, 0, 0, input.rows, input.cols);
+        break;
+    case 6:
+        transposeBlock<Element<6>>(input, output, 0, 0, input.rows, input.cols);
+        break;
+    case 12:
+        transposeBlock<Element<12>>(input, output, 0, 0, input.rows, input.cols);
+        break;
+    case 16:
+        transposeBlock<Element<16>>(input, output, 0, 0, input.rows, input.cols);
+        break;
+    default:
+        cv::transpose(input, output);
+    }
+}
+
+std::vector<int> seam::seamVertical(cv::Mat& gradientImage, std::vector<std::vector<bool>>& blockedPixels)
+{
+    /* blockedPixels has an additional border column on the left and on the right */
+    SeamContext context(gradientImage.rows, gradientImage.cols);
+    for (int i = 0; i < gradientImage.rows; i++)
+        for (int j = 0; j < gradientImage.cols; j++)
+            if (blockedPixels[i][j+1])
+                context.block(i, j);
+
+    std::vector<int> result;
+    if (seamVertical(gradientImage, context, result))
+        for (int i = 0; i < gradientImage.rows; i++)
+            blockedPixels[i][result[i]+1] = true;
     return result;
 }
 
 std::vector<int> seam::seamHorizontal(cv::Mat& gradientImage, std::vector<std::vector<bool>>& blockedPixels)
 {
-    const int nrows = gradientImage.rows, ncols = gradientImage.cols;
-    CV_Assert(gradientImage.depth() == CV_8UC1);  // accept only uchar single channel images
-    /* create 2D vector for energy sums with additional border to prevent edge cases */
-    std::vector<std::vector<ulong>> energySum(nrows + 2, std::vector<ulong>(ncols, UINT_MAX));
-    /* initialize first col */
-    for (int i = 0; i < nrows; i++) {
-        energySum[i+1][0] = blockedPixels[i+1][0] ? UINT_MAX : gradientImage.at<uchar>(i, 0);
+    /* blockedPixels has an additional border row at the top and at the bottom */
+    SeamContext context(gradientImage.cols, gradientImage.rows);
+    for (int i = 0; i < gradientImage.rows; i++)
+        for (int j = 0; j < gradientImage.cols; j++)
+            if (blockedPixels[i+1][j])
+                context.block(j, i);
+
+    std::vector<int> result;
+    if (seamHorizontal(gradientImage, context, result))
+        for (int j = 0; j < gradientImage.cols; j++)
+            blockedPixels[result[j]+1][j] = true;
+    return result;
+}
+
+namespace {
+    /**
+     * @brief Removes the pixels of a vertical seam by shifting the rest of every row to the left.
+     * @param width - the number of used columns of the image.
+     */
+    void removeSeamInPlace(cv::Mat& image, int width, const std::vector<int>& seam)
+    {
+        const size_t pixelSize = image.elemSize();
+        for (int i = 0; i < image.rows; i++) {
+            uchar* row = image.ptr<uchar>(i);
+            std::memmove(row + seam[i] * pixelSize, row + (seam[i] + 1) * pixelSize,
+                         (width - seam[i] - 1) * pixelSize);
+            SEAM_COUNT("bytes_copied", (width - seam[i] - 1) * pixelSize);
+        }
     }
-    /* Compute energy sum via: E[i,j] = G[i,j] + min{E[i-1,j-1], E[i,j-1], E[i+1,j-1]} */
-    for (int j = 1; j < ncols; j++) {
+
+    /**
+     * @brief Updates the energy and energy sums after a seam was removed from the grayscale image.
+     *
+     * @details All energy functions only depend on the 3x3 neighbourhood of a pixel, so the energy only changes,
+     * if the seam crossed it, and only a band of a few pixels around the seam is recomputed per row. An energy
+     * sum only changes, if its energy changed or one of the three energy sums above it, so the range of changed
+     * energy sums is tracked from row to row. It grows by one column per row at most, but usually shrinks back
+     * to the band quickly.
+     */
+    template <typename Cost>
+    void updateAfterSeamRemoval(seam::EnergyFunction function, const cv::Mat& grayscaleImage, const cv::Mat& mask,
+                                cv::Mat& energyImage, seam::SeamContext& context, const std::vector<int>& seam)
+    {
+        const int nrows = grayscaleImage.rows, ncols = grayscaleImage.cols;
+        int changedBegin = 0, changedEnd = 0;
         for (int i = 0; i < nrows; i++) {
-            /* mind offset for column because of border */
-            ulong energyValue = static_cast<ulong>(gradientImage.at<uchar>(i,j));
-            /* pixel can't be used, if it is blocked or if it would cause a crossing of seams */
-            if (blockedPixels[i+1][j-1]) {
-                if (blockedPixels[i][j])
-                    energySum[i+1][j] = energyValue + energySum[i+2][j-1];
-                else if (blockedPixels[i+2][j])
-                    energySum[i+1][j] = energyValue + energySum[i][j-1];
+            /* the energy of the border rows is taken from their inner neighbours */
+            const int row = std::min(std::max(i, 1), nrows - 2);
+            const int seamBegin = std::min(seam[row-1], std::min(seam[row], seam[row+1]));
+            const int seamEnd = std::max(seam[row-1], std::max(seam[row], seam[row+1]));
+            const int bandBegin = std::max(seamBegin - 2, 0), bandEnd = std::min(seamEnd + 2, ncols);
+            energyRow(function, grayscaleImage, mask, energyImage, i, bandBegin, bandEnd);
+
+            int begin = bandBegin, end = bandEnd;
+            if (changedBegin < changedEnd) {
+                begin = std::min(begin, std::max(changedBegin - 1, 0));
+                end = std::max(end, std::min(changedEnd + 1, ncols));
+            }
+            updateEnergySumRow(context, i, rowCost<Cost>(energyImage, context, i), begin, end, changedBegin,
+                               changedEnd);
+        }
+    }
+
+    /**
+     * @brief Tells progress about a removed seam and shows the image carved so far every previewInterval seams.
+     * @param removed - the number of seams the carve removed so far.
+     * @param transposed - the image is transposed, because the carve removes horizontal seams.
+     * @return false, if the carve is cancelled.
+     */
+    bool reportSeam(seam::CarveProgress& progress, int removed, const cv::Mat& image, bool transposed)
+    {
+        if (progress.preview && progress.previewInterval > 0 && removed % progress.previewInterval == 0) {
+            if (transposed) {
+                cv::Mat preview;
+                seam::transpose(image, preview);
+                progress.preview(preview);
             } else {
-                energySum[i+1][j] = blockedPixels[i+1][j] ? UINT_MAX : energyValue + std::min(energySum[i][j-1],
-                        std::min(energySum[i+1][j-1], energySum[i+2][j-1]));
-            }
-        }
-    }
-    /* backtrack the seam with the lowest energy sum and set seam to UCHAR_MAX on gradient image */
-    std::vector<int> result(ncols);
-    uint row = 0, min = UINT_MAX;
-    for (int i = 1; i <= nrows; i++) {
-        if (energySum[i][ncols-1] < min) {
-            min = energySum[i][ncols-1];
-            row = i;
-        }
-    }
-    if (row == 0) /* all pixels are blocked, seams can't be computed. */
-        return std::vector<int>();
-    gradientImage.at<uchar>(row-1, ncols-1) = UCHAR_MAX;
-    /* block pixel of seam and the two neighbours to the left and right to prevent crossing */
-    blockedPixels[row][ncols-1] = true;
-    result[ncols-1] = row - 1;
-    for (int i = ncols-2; i >= 0; i--) {
-        /* find next column index: I[i,j] = argmin{I[i-1,j+1], I[i,j+1], I[i+1, j+1]} and
-            delete seam by setting it on high values/blocking pixels. */
-        min = UINT_MAX;
-        int nextRow = 0;
-        for (int j = -1; j <= 1; j++) {
-            if (energySum[row+j][i] < min){
-                min = energySum[row+j][i];
-                nextRow = row + j;
-            }
-        }
-        if (row == 0) /* all pixels are blocked, seams can't be computed. */
-            return std::vector<int>();
-        else row = nextRow;
-        gradientImage.at<uchar>(row-1, i) = UCHAR_MAX;
-        /* block pixel of seam and the two neighbours to the left and right to prevent crossing */
-        blockedPixels[row][i] = true;
-        result[i] = row - 1;
+                progress.preview(image);
+            }
+        }
+        return !progress.seamRemoved || progress.seamRemoved();
     }
-    return result;
+
+    /**
+     * @brief Removes vertical seams one at a time.
+     * @param outputMask - the mask with the same seams removed, if the input mask is not empty.
+     * @param order - if not nullptr, receives the index of the seam which removed each pixel of the input.
+     * @param progress - if not nullptr, is told about every seam and may cancel the carve.
+     * @param transposed - the input is transposed, so previews have to be transposed back.
+     * @return false, if the carve was cancelled, the output then has the seams removed so far.
+     */
+    template <typename Cost>
+    bool carveVertical(const cv::Mat& input, cv::Mat& output, int numberOfSeams, seam::EnergyFunction function,
+                       const cv::Mat& inputMask, cv::Mat& outputMask, cv::Mat* order, seam::CarveProgress* progress,
+                       bool transposed)
+    {
+        const int nrows = input.rows, ncols = input.cols;
+        /* the image keeps its type, the seams are computed on its 8 bit grayscale version */
+        cv::Mat image = input.clone();
+        cv::Mat grayscaleImage;
+        seam::grayscale(image, grayscaleImage);
+        if (grayscaleImage.data == image.data)
+            grayscaleImage = image.clone();
+        cv::Mat mask = inputMask.clone();
+        cv::Mat energyImage;
+        seam::energy(grayscaleImage, energyImage, function, mask);
+
+        seam::SeamContext context(nrows, ncols);
+        context.setMask(mask);
+        energySums<Cost>(energyImage, context);
+
+        /* the column of the input of every remaining pixel, to find the pixels of the seams in the input */
+        cv::Mat inputColumns;
+        if (order) {
+            order->create(nrows, ncols, CV_16UC1);
+            order->setTo(seam::REMOVAL_ORDER_KEPT);
+            inputColumns.create(nrows, ncols, CV_32SC1);
+            for (int i = 0; i < nrows; i++) {
+                int* columns = inputColumns.ptr<int>(i);
+                for (int j = 0; j < ncols; j++)
+                    columns[j] = j;
+            }
+        }
+
+        std::vector<int> seam;
+        int removed = 0;
+        bool cancelled = false;
+        for (int n = 0; n < numberOfSeams && !cancelled; n++) {
+            const int width = ncols - n;
+            {
+                SEAM_SCOPED_TIMER("seam.backtrack");
+                backtrackSeam<Cost>(context, energyImage, seam); /* no pixels are blocked, so there always is a seam */
+            }
+            SEAM_COUNT("seams_computed", 1);
+            if (order) {
+                for (int i = 0; i < nrows; i++)
+                    order->at<uint16_t>(i, inputColumns.at<int>(i, seam[i])) = static_cast<uint16_t>(n);
+                removeSeamInPlace(inputColumns, width, seam);
+            }
+            {
+                SEAM_SCOPED_TIMER("carve.remove");
+                removeSeamInPlace(image, width, seam);
+                removeSeamInPlace(grayscaleImage, width, seam);
+                removeSeamInPlace(energyImage, width, seam);
+                if (!mask.empty())
+                    removeSeamInPlace(mask, width, seam);
+                context.removeSeam(seam);
+            }
+            /* only the used columns are passed on, the images keep their memory */
+            {
+                SEAM_SCOPED_TIMER("carve.update");
+                updateAfterSeamRemoval<Cost>(function, grayscaleImage.colRange(0, width - 1),
+                                             mask.empty() ? mask : mask.colRange(0, width - 1),
+                                             energyImage, context, seam);
+            }
+            removed = n + 1;
+            /* a cancel with the last seam still stops a caller, which carves more afterwards */
+            cancelled = progress && !reportSeam(*progress, removed, image.colRange(0, width - 1), transposed);
+        }
+        image.colRange(0, ncols - removed).copyTo(output);
+        if (!mask.empty())
+            mask.colRange(0, ncols - removed).copyTo(outputMask);
+        return !cancelled;
+    }
+
+    bool carveVertical(const cv::Mat& input, cv::Mat& output, int numberOfSeams, seam::EnergyFunction function,
+                       const cv::Mat& mask, cv::Mat& outputMask, cv::Mat* order = nullptr,
+                       seam::CarveProgress* progress = nullptr, bool transposed = false)
+    {
+        CV_Assert(input.rows >= 3 && numberOfSeams >= 0 && numberOfSeams <= input.cols - 3);
+        CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.size() == input.size()));
+        CV_Assert(!order || numberOfSeams < seam::REMOVAL_ORDER_KEPT);
+        if (!mask.empty() && energyFunctions[function].channels == 1)
+            return carveVertical<MaskedCost<BackwardCost>>(input, output, numberOfSeams, function, mask, outputMask,
+                                                           order, progress, transposed);
+        if (!mask.empty())
+            return carveVertical<MaskedCost<ForwardCost>>(input, output, numberOfSeams, function, mask, outputMask,
+                                                          order, progress, transposed);
+        if (energyFunctions[function].channels == 1)
+            return carveVertical<BackwardCost>(input, output, numberOfSeams, function, mask, outputMask, order,
+                                               progress, transposed);
+        return carveVertical<ForwardCost>(input, output, numberOfSeams, function, mask, outputMask, order,
+                                          progress, transposed);
+    }
+
+    bool carveHorizontal(const cv::Mat& input, cv::Mat& output, int numberOfSeams, seam::EnergyFunction function,
+                         const cv::Mat& mask, cv::Mat& outputMask, cv::Mat* order = nullptr,
+                         seam::CarveProgress* progress = nullptr)
+    {
+        /* carving the transposed image vertically removes horizontal seams */
+        cv::Mat transposed, transposedMask, carved, carvedMask, transposedOrder;
+        seam::transpose(input, transposed);
+        if (!mask.empty())
+            seam::transpose(mask, transposedMask);
+        const bool completed = carveVertical(transposed, carved, numberOfSeams, function, transposedMask, carvedMask,
+                                             order ? &transposedOrder : nullptr, progress, true);
+        seam::transpose(carved, output);
+        if (!mask.empty())
+            seam::transpose(carvedMask, outputMask);
+        if (order)
+            seam::transpose(transposedOrder, *order);
+        return completed;
+    }
+} // namespace
+
+void seam::carveVertical(const cv::Mat& input, cv::Mat& output, int numberOfSeams, EnergyFunction function,
+                         const cv::Mat& mask)
+{
+    SEAM_SCOPED_TIMER("carve");
+    cv::Mat outputMask;
+    ::carveVertical(input, output, numberOfSeams, function, mask, outputMask);
 }
 
-void seam::deleteSeamsVertical(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& seams)
+void seam::carveHorizontal(const cv::Mat& input, cv::Mat& output, int numberOfSeams, EnergyFunction function,
+                           const cv::Mat& mask)
+{
+    SEAM_SCOPED_TIMER("carve");
+    cv::Mat outputMask;
+    ::carveHorizontal(input, output, numberOfSeams, function, mask, outputMask);
+}
+
+bool seam::carve(const cv::Mat& input, cv::Mat& output, int colsToRemove, int rowsToRemove, EnergyFunction function,
+                 const cv::Mat& mask, CarveProgress* progress)
 {
-    const int newNumberOfCols = input.cols - seams.size();
-    const int nChannels = input.channels();
-    output.create(input.rows, newNumberOfCols, input.type());
+    SEAM_SCOPED_TIMER("carve");
+    /* the mask has to follow the vertical seams, before it is used for the horizontal seams */
+    cv::Mat verticalCarved, verticalCarvedMask, carvedMask;
+    if (!::carveVertical(input, verticalCarved, colsToRemove, function, mask, verticalCarvedMask, nullptr, progress)) {
+        output = verticalCarved;
+        return false;
+    }
+    return ::carveHorizontal(verticalCarved, output, rowsToRemove, function, verticalCarvedMask, carvedMask,
+                             nullptr, progress);
+}
 
-    /* for every row, copy all values from input, while ignoring pixels from seams */
-    for (int i = 0; i < input.rows; i++) {
-        int seamOffset = 0; /* number of seams in this row, that were already crossed */
-        const uchar* inputRow = input.ptr<uchar>(i);
-        uchar* outputRow = output.ptr<uchar>(i);
-        for (int j = 0; j < nChannels * newNumberOfCols; j++) {
-            if (static_cast<size_t>(seamOffset) < seams.size() && seams[seamOffset][i] * nChannels <= j)
-                seamOffset++;
-            *outputRow = inputRow[j + seamOffset * nChannels];
-            outputRow++;
+bool seam::removalOrderVertical(const cv::Mat& input, cv::Mat& order, int numberOfSeams, EnergyFunction function,
+                                const cv::Mat& mask, CarveProgress* progress)
+{
+    SEAM_SCOPED_TIMER("carve");
+    cv::Mat output, outputMask;
+    return ::carveVertical(input, output, numberOfSeams, function, mask, outputMask, &order, progress);
+}
+
+bool seam::removalOrderHorizontal(const cv::Mat& input, cv::Mat& order, int numberOfSeams, EnergyFunction function,
+                                  const cv::Mat& mask, CarveProgress* progress)
+{
+    SEAM_SCOPED_TIMER("carve");
+    cv::Mat output, outputMask;
+    return ::carveHorizontal(input, output, numberOfSeams, function, mask, outputMask, &order, progress);
+}
+
+namespace {
+    /**
+     * @brief An entry of the transport map: the image with some rows and columns removed in the cheapest order,
+     * and the cheapest seam of each direction, which can be removed next.
+     */
+    struct TransportCell
+    {
+        cv::Mat image;
+        cv::Mat mask;
+        uint64_t cost = 0; /* sum of the energy of all seams removed so far */
+        std::vector<int> verticalSeam;
+        std::vector<int> horizontalSeam;
+        uint32_t verticalCost = 0;
+        uint32_t horizontalCost = 0;
+    };
+
+    /**
+     * @brief Computes the cheapest vertical and horizontal seam of a cell, if the image can lose a column or a row.
+     */
+    void computeCellSeams(TransportCell& cell, seam::EnergyFunction function, bool vertical, bool horizontal)
+    {
+        const int nrows = cell.image.rows, ncols = cell.image.cols;
+        cv::Mat energyImage, horizontalEnergy;
+        seam::energy(cell.image, energyImage, function, cell.mask);
+        if (horizontal) {
+            /* the seams are marked on the energy image, so each direction needs its own */
+            if (energyFunctions[function].channels != 1)
+                seam::energy(cell.image, horizontalEnergy, function, cell.mask, true);
+            else
+                horizontalEnergy = vertical ? energyImage.clone() : energyImage;
+            seam::SeamContext context(ncols, nrows);
+            seam::seamHorizontal(horizontalEnergy, context, cell.horizontalSeam, &cell.horizontalCost);
+        }
+        if (vertical) {
+            seam::SeamContext context(nrows, ncols);
+            seam::seamVertical(energyImage, context, cell.verticalSeam, &cell.verticalCost);
         }
     }
+} // namespace
+
+void seam::optimalSeamOrder(const cv::Mat& input, std::vector<bool>& order, int colsToRemove, int rowsToRemove,
+                            EnergyFunction function, const cv::Mat& mask)
+{
+    SEAM_SCOPED_TIMER("transport");
+    CV_Assert(colsToRemove >= 0 && colsToRemove <= input.cols - 3);
+    CV_Assert(rowsToRemove >= 0 && rowsToRemove <= input.rows - 3);
+    CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.size() == input.size()));
+    const int ncells = colsToRemove + 1;
+    /* whether the cell (r, c) with r rows and c columns removed is reached by removing a vertical seam */
+    std::vector<uchar> verticalStep(static_cast<size_t>(rowsToRemove + 1) * ncells, 0);
+
+    std::vector<TransportCell> previous(1), current;
+    previous[0].image = input;
+    previous[0].mask = mask;
+    computeCellSeams(previous[0], function, colsToRemove > 0, rowsToRemove > 0);
+
+    /* a cell only depends on its upper and left neighbour, so all cells of an anti-diagonal are independent */
+    for (int d = 1; d <= colsToRemove + rowsToRemove; d++) {
+        const int previousBegin = std::max(0, d - 1 - colsToRemove);
+        const int rowBegin = std::max(0, d - colsToRemove), rowEnd = std::min(rowsToRemove, d);
+        current.assign(rowEnd - rowBegin + 1, TransportCell());
+        cv::parallel_for_(cv::Range(rowBegin, rowEnd + 1), [&](const cv::Range& cells) {
+            for (int r = cells.start; r < cells.end; r++) {
+                const int c = d - r;
+                const TransportCell* left = c > 0 ? &previous[r - previousBegin] : nullptr;
+                const TransportCell* up = r > 0 ? &previous[r - 1 - previousBegin] : nullptr;
+                /* on equal costs, columns are removed first like carve() does */
+                const bool vertical = !up || (left && left->cost + left->verticalCost <= up->cost + up->horizontalCost);
+                TransportCell& cell = current[r - rowBegin];
+                const std::vector<std::vector<int>> seams(1, vertical ? left->verticalSeam : up->horizontalSeam);
+                const TransportCell& source = vertical ? *left : *up;
+                cell.cost = source.cost + (vertical ? source.verticalCost : source.horizontalCost);
+                if (vertical) {
+                    seam::deleteSeamsVertical(source.image, cell.image, seams);
+                    if (!source.mask.empty())
+                        seam::deleteSeamsVertical(source.mask, cell.mask, seams);
+                } else {
+                    seam::deleteSeamsHorizontal(source.image, cell.image, seams);
+                    if (!source.mask.empty())
+                        seam::deleteSeamsHorizontal(source.mask, cell.mask, seams);
+                }
+                verticalStep[static_cast<size_t>(r) * ncells + c] = vertical;
+                computeCellSeams(cell, function, c < colsToRemove, r < rowsToRemove);
+            }
+        });
+        SEAM_COUNT("transport_cells", current.size());
+        previous.swap(current);
+    }
+
+    /* follow the choices back from the target size */
+    order.resize(colsToRemove + rowsToRemove);
+    for (int r = rowsToRemove, c = colsToRemove; r + c > 0;) {
+        const bool vertical = verticalStep[static_cast<size_t>(r) * ncells + c] != 0;
+        order[r + c - 1] = vertical;
+        if (vertical)
+            c--;
+        else
+            r--;
+    }
 }
 
-void seam::deleteSeamsHorizontal(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& seams)
+bool seam::carveOptimal(const cv::Mat& input, cv::Mat& output, int colsToRemove, int rowsToRemove,
+                        EnergyFunction function, const cv::Mat& mask, CarveProgress* progress)
 {
-    const int newNumberOfCols = input.cols - seams.size();
-    const int nChannels = input.channels();
-    int newNumberOfRows = input.rows - seams.size();
-    output.create(newNumberOfRows, input.cols, input.type());
+    SEAM_SCOPED_TIMER("carve");
+    std::vector<bool> order;
+    optimalSeamOrder(input, order, colsToRemove, rowsToRemove, function, mask);
+
+    /* every run of seams of the same direction is carved with the incremental energy updates */
+    cv::Mat image = input, imageMask = mask;
+    for (size_t begin = 0; begin < order.size();) {
+        size_t end = begin;
+        while (end < order.size() && order[end] == order[begin])
+            end++;
+        cv::Mat carved, carvedMask;
+        const bool completed = order[begin]
+                ? ::carveVertical(image, carved, static_cast<int>(end - begin), function, imageMask, carvedMask,
+                                  nullptr, progress)
+                : ::carveHorizontal(image, carved, static_cast<int>(end - begin), function, imageMask, carvedMask,
+                                    nullptr, progress);
+        image = carved;
+        imageMask = carvedMask;
+        begin = end;
+        if (!completed) {
+            output = image;
+            return false;
+        }
+    }
+    output = order.empty() ? input.clone() : image;
+    return true;
+}
+
+namespace {
+    /**
+     * @brief Sorts a range which is almost sorted in linear time.
+     */
+    void insertionSort(int* begin, int* end)
+    {
+        for (int* i = begin + 1; i < end; i++) {
+            const int value = *i;
+            int* j = i;
+            for (; j > begin && *(j-1) > value; j--)
+                *j = *(j-1);
+            *j = value;
+        }
+    }
+
+    /**
+     * @brief Returns the order of the seams by their first entry.
+     */
+    std::vector<size_t> seamOrder(const std::vector<std::vector<int>>& seams)
+    {
+        std::vector<size_t> order(seams.size());
+        for (size_t s = 0; s < order.size(); s++)
+            order[s] = s;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return seams[a][0] < seams[b][0]; });
+        return order;
+    }
+
+    /**
+     * @brief Sorts the removed columns of every row, so that each row of the result holds the columns of all
+     * vertical seams in ascending order.
+     * @param removedColumns - rows * verticalSeams.size() entries.
+     *
+     * @details Seams computed on the same image don't cross, so they are in the same order in every row and
+     * the rows only need to be checked.
+     */
+    void sortRemovedColumns(const std::vector<std::vector<int>>& verticalSeams, int nrows, int ncols,
+                            std::vector<int>& removedColumns)
+    {
+        const size_t nseams = verticalSeams.size();
+        for (const std::vector<int>& seam : verticalSeams)
+            CV_Assert(seam.size() == static_cast<size_t>(nrows));
+        const std::vector<size_t> order = seamOrder(verticalSeams);
+
+        removedColumns.resize(nrows * nseams);
+        for (int i = 0; i < nrows; i++) {
+            int* row = removedColumns.data() + i * nseams;
+            for (size_t s = 0; s < nseams; s++)
+                row[s] = verticalSeams[order[s]][i];
+            insertionSort(row, row + nseams);
+            /* seams computed on the same image never share a pixel */
+            for (size_t s = 0; s < nseams; s++)
+                CV_Assert(row[s] >= 0 && row[s] < ncols && (s == 0 || row[s-1] < row[s]));
+        }
+    }
+
+    /**
+     * @brief Maps horizontal seams onto the image with the vertical seams removed or inserted.
+     * @param removedRows - for every column of that image the rows of all horizontal seams in ascending order,
+     * newNCols * horizontalSeams.size() entries.
+     * @param inserted - whether the vertical seams are inserted instead of removed.
+     *
+     * @details Every pixel of a horizontal seam, which is not removed by a vertical seam, is moved to its column
+     * in the new image, a pixel of an inserted vertical seam to both of its columns. A column, which no pixel
+     * of the seam is moved to, takes the row of its left neighbour. Where two horizontal seams end up in the
+     * same row of a column, the later one is moved to the next free row, so that every column loses (or gains)
+     * exactly one pixel per seam.
+     */
+    void mapHorizontalSeams(const std::vector<std::vector<int>>& horizontalSeams, const std::vector<int>& removedColumns,
+                            size_t nVerticalSeams, int nrows, int ncols, std::vector<int>& removedRows,
+                            bool inserted = false)
+    {
+        const int newNCols = inserted ? ncols + static_cast<int>(nVerticalSeams)
+                                      : ncols - static_cast<int>(nVerticalSeams);
+        const size_t nseams = horizontalSeams.size();
+        CV_Assert(nseams <= static_cast<size_t>(nrows));
+        removedRows.assign(newNCols * nseams, -1);
+
+        for (const std::vector<int>& seam : horizontalSeams)
+            CV_Assert(seam.size() == static_cast<size_t>(ncols));
+        /* in this order, the rows of a column are usually sorted already */
+        const std::vector<size_t> order = seamOrder(horizontalSeams);
+        for (size_t s = 0; s < nseams; s++) {
+            const std::vector<int>& seam = horizontalSeams[order[s]];
+            int firstColumn = newNCols;
+            for (int j = 0; j < ncols; j++) {
+                const int i = seam[j];
+                CV_Assert(i >= 0 && i < nrows);
+                const int* removed = removedColumns.data() + i * nVerticalSeams;
+                const int* skipped = std::lower_bound(removed, removed + nVerticalSeams, j);
+                const bool onVerticalSeam = skipped != removed + nVerticalSeams && *skipped == j;
+                if (onVerticalSeam && !inserted)
+                    continue;
+                const int passed = static_cast<int>(skipped - removed);
+                const int newColumn = inserted ? j + passed : j - passed;
+                /* a pixel of an inserted seam becomes two pixels */
+                for (int column = newColumn; column <= newColumn + (onVerticalSeam ? 1 : 0); column++) {
+                    int& row = removedRows[column * nseams + s];
+                    if (row < 0)
+                        row = i;
+                }
+                firstColumn = std::min(firstColumn, newColumn);
+            }
+            for (int j = 0; j < newNCols; j++) {
+                int& row = removedRows[j * nseams + s];
+                if (row < 0)
+                    row = j < firstColumn ? removedRows[firstColumn * nseams + s] : removedRows[(j-1) * nseams + s];
+            }
+        }
+
+        /* make the rows of every column unique and keep them inside the image */
+        for (int j = 0; j < newNCols; j++) {
+            int* rows = removedRows.data() + j * nseams;
+            insertionSort(rows, rows + nseams);
+            for (size_t s = 1; s < nseams; s++)
+                rows[s] = std::max(rows[s], rows[s-1] + 1);
+            for (size_t s = nseams; s-- > 0;)
+                rows[s] = std::min(rows[s], s + 1 < nseams ? rows[s+1] - 1 : nrows - 1);
+        }
+    }
+
+    /**
+     * @brief Copies all pixels which are not removed in one row-major pass.
+     * @param removedColumns - see sortRemovedColumns().
+     * @param removedRows - see mapHorizontalSeams().
+     *
+     * @details The output pixel (i, j) is the i-th kept pixel of column j of the image with the vertical seams
+     * removed, so its input row is i plus the number of removed rows passed in column j, which is tracked per
+     * column. Its input column is j plus the number of removed columns passed in that input row, which is
+     * tracked per input row. Every output row is split into runs with the same input row and no removed column
+     * in between, which are copied with one memcpy each.
+     */
+    void deleteSeams(const cv::Mat& input, cv::Mat& output, const std::vector<int>& removedColumns,
+                     size_t nVerticalSeams, const std::vector<int>& removedRows, size_t nHorizontalSeams)
+    {
+        const int newNRows = input.rows - static_cast<int>(nHorizontalSeams);
+        const int newNCols = input.cols - static_cast<int>(nVerticalSeams);
+        const size_t pixelSize = input.elemSize();
+        output.create(newNRows, newNCols, input.type());
+        SEAM_COUNT("bytes_copied", output.total() * pixelSize);
+
+        std::vector<int> passedRows(newNCols, 0);           /* removed rows above the current row per column */
+        std::vector<int> passedColumns(input.rows, 0);      /* removed columns left of the current run per row */
+        std::vector<int> passedColumnsRow(input.rows, -1);  /* output row, for which passedColumns is valid */
+
+        for (int i = 0; i < newNRows; i++) {
+            if (nHorizontalSeams > 0) {
+                for (int j = 0; j < newNCols; j++) {
+                    const int* rows = removedRows.data() + j * nHorizontalSeams;
+                    int& rowOffset = passedRows[j];
+                    while (static_cast<size_t>(rowOffset) < nHorizontalSeams && rows[rowOffset] <= i + rowOffset)
+                        rowOffset++;
+                }
+            }
+
+            uchar* outputRow = output.ptr<uchar>(i);
+            int j = 0;
+            while (j < newNCols) {
+                /* columns which take their pixels from the same input row */
+                int end = nHorizontalSeams > 0 ? j + 1 : newNCols;
+                while (end < newNCols && passedRows[end] == passedRows[j])
+                    end++;
+                const int inputRow = i + passedRows[j];
+                const uchar* inputPixels = input.ptr<uchar>(inputRow);
 
-    /* for every column, copy all values from input, while ignoring pixels from seams */
-    for (int j = 0; j < input.cols; j++) {
-        int seamOffset = 0; /* number of seams in this column, that were already crossed */
-        for (int i = 0; i < newNumberOfRows; i++) {
-            if (static_cast<size_t>(seamOffset) < seams.size() && seams[seamOffset][j] <= i)
-                seamOffset++;
-            output.at<cv::Vec3b>(i,j) = input.at<cv::Vec3b>(i + seamOffset, j);
+                int& columnOffset = passedColumns[inputRow];
+                if (passedColumnsRow[inputRow] != i) {
+                    passedColumnsRow[inputRow] = i;
+                    columnOffset = 0;
+                }
+                const int* columns = removedColumns.data() + inputRow * nVerticalSeams;
+                while (j < end) {
+                    while (static_cast<size_t>(columnOffset) < nVerticalSeams && columns[columnOffset] <= j + columnOffset)
+                        columnOffset++;
+                    /* copy up to the next removed column */
+                    const int stop = static_cast<size_t>(columnOffset) < nVerticalSeams
+                                   ? std::min(end, columns[columnOffset] - columnOffset) : end;
+                    std::memcpy(outputRow + j * pixelSize, inputPixels + (j + columnOffset) * pixelSize,
+                                (stop - j) * pixelSize);
+                    j = stop;
+                }
+            }
         }
     }
+
+    typedef void (*AverageFunction)(const uchar* first, const uchar* second, uchar* result, int channels);
+
+    template <typename T>
+    void averagePixels(const uchar* first, const uchar* second, uchar* result, int channels)
+    {
+        const T* a = reinterpret_cast<const T*>(first);
+        const T* b = reinterpret_cast<const T*>(second);
+        T* average = reinterpret_cast<T*>(result);
+        for (int c = 0; c < channels; c++)
+            average[c] = cv::saturate_cast<T>((static_cast<double>(a[c]) + b[c]) / 2);
+    }
+
+    /**
+     * @brief Returns the function, which averages two pixels of the given depth.
+     */
+    AverageFunction averageFunction(int depth)
+    {
+        switch (depth) {
+        case CV_8U:
+            return averagePixels<uchar>;
+        case CV_8S:
+            return averagePixels<schar>;
+        case CV_16U:
+            return averagePixels<ushort>;
+        case CV_16S:
+            return averagePixels<short>;
+        case CV_32S:
+            return averagePixels<int>;
+        case CV_32F:
+            return averagePixels<float>;
+        default:
+            CV_Assert(depth == CV_64F);
+            return averagePixels<double>;
+        }
+    }
+
+    /**
+     * @brief Inserts vertical seams in one pass. Every seam pixel is replaced by the average with its left
+     * neighbour followed by the average with its right neighbour, so the seam is widened to two pixels.
+     * @param insertedColumns - see sortRemovedColumns().
+     *
+     * @details The columns of a row are sorted, so the output column of the k-th seam pixel is its input column
+     * plus k, and the pixels between two seam pixels are copied with one memcpy.
+     */
+    void insertSeamsVertical(const cv::Mat& input, cv::Mat& output, const std::vector<int>& insertedColumns,
+                             size_t nseams)
+    {
+        const int ncols = input.cols, channels = input.channels();
+        const size_t pixelSize = input.elemSize();
+        const AverageFunction average = averageFunction(input.depth());
+        output.create(input.rows, ncols + static_cast<int>(nseams), input.type());
+        SEAM_COUNT("bytes_copied", output.total() * pixelSize);
+
+        for (int i = 0; i < input.rows; i++) {
+            const uchar* inputRow = input.ptr<uchar>(i);
+            uchar* outputRow = output.ptr<uchar>(i);
+            const int* columns = insertedColumns.data() + i * nseams;
+            int begin = 0;
+            for (size_t s = 0; s < nseams; s++) {
+                const int j = columns[s];
+                std::memcpy(outputRow + (begin + s) * pixelSize, inputRow + begin * pixelSize, (j - begin) * pixelSize);
+                const uchar* pixel = inputRow + j * pixelSize;
+                average(j > 0 ? pixel - pixelSize : pixel, pixel, outputRow + (j + s) * pixelSize, channels);
+                average(pixel, j + 1 < ncols ? pixel + pixelSize : pixel, outputRow + (j + s + 1) * pixelSize,
+                        channels);
+                begin = j + 1;
+            }
+            std::memcpy(outputRow + (begin + nseams) * pixelSize, inputRow + begin * pixelSize,
+                        (ncols - begin) * pixelSize);
+        }
+    }
+
+    /**
+     * @brief Inserts horizontal seams in one row-major pass, like insertSeamsVertical() does for vertical seams.
+     * @param insertedRows - for every column the rows of all seams in ascending order, see mapHorizontalSeams().
+     *
+     * @details The seams passed so far are tracked per column, an input pixel moves down by their number. Runs
+     * of columns, which move by the same number and have no seam pixel in the current row, are copied with one
+     * memcpy.
+     */
+    void insertSeamsHorizontal(const cv::Mat& input, cv::Mat& output, const std::vector<int>& insertedRows,
+                               size_t nseams)
+    {
+        const int nrows = input.rows, ncols = input.cols, channels = input.channels();
+        const size_t pixelSize = input.elemSize();
+        const AverageFunction average = averageFunction(input.depth());
+        output.create(nrows + static_cast<int>(nseams), ncols, input.type());
+        SEAM_COUNT("bytes_copied", output.total() * pixelSize);
+
+        std::vector<int> passedRows(ncols, 0); /* seams above the current row per column */
+        for (int i = 0; i < nrows; i++) {
+            const uchar* inputRow = input.ptr<uchar>(i);
+            int j = 0;
+            while (j < ncols) {
+                const int* rows = insertedRows.data() + j * nseams;
+                const int offset = passedRows[j];
+                if (static_cast<size_t>(offset) < nseams && rows[offset] == i) {
+                    const uchar* pixel = inputRow + j * pixelSize;
+                    const uchar* above = i > 0 ? input.ptr<uchar>(i - 1) + j * pixelSize : pixel;
+                    const uchar* below = i + 1 < nrows ? input.ptr<uchar>(i + 1) + j * pixelSize : pixel;
+                    average(above, pixel, output.ptr<uchar>(i + offset) + j * pixelSize, channels);
+                    average(pixel, below, output.ptr<uchar>(i + offset + 1) + j * pixelSize, channels);
+                    passedRows[j]++;
+                    j++;
+                    continue;
+                }
+                int end = j + 1;
+                while (end < ncols && passedRows[end] == offset &&
+                       !(static_cast<size_t>(offset) < nseams && insertedRows[end * nseams + offset] == i))
+                    end++;
+                std::memcpy(output.ptr<uchar>(i + offset) + j * pixelSize, inputRow + j * pixelSize,
+                            (end - j) * pixelSize);
+                j = end;
+            }
+        }
+    }
+} // namespace
+
+void seam::deleteSeams(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& verticalSeams,
+                       const std::vector<std::vector<int>>& horizontalSeams)
+{
+    SEAM_SCOPED_TIMER("delete");
+    CV_Assert(input.data != output.data || input.empty());
+    CV_Assert(verticalSeams.size() < static_cast<size_t>(input.cols));
+    CV_Assert(horizontalSeams.size() < static_cast<size_t>(input.rows));
+    std::vector<int> removedColumns, removedRows;
+    {
+        SEAM_SCOPED_TIMER("delete.map");
+        sortRemovedColumns(verticalSeams, input.rows, input.cols, removedColumns);
+        mapHorizontalSeams(horizontalSeams, removedColumns, verticalSeams.size(), input.rows, input.cols, removedRows);
+    }
+    ::deleteSeams(input, output, removedColumns, verticalSeams.size(), removedRows, horizontalSeams.size());
+}
+
+void seam::deleteSeamsVertical(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& seams)
+{
+    deleteSeams(input, output, seams, std::vector<std::vector<int>>());
+}
+
+void seam::deleteSeamsHorizontal(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& seams)
+{
+    deleteSeams(input, output, std::vector<std::vector<int>>(), seams);
+}
+
+void seam::insertSeams(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& verticalSeams,
+                       const std::vector<std::vector<int>>& horizontalSeams)
+{
+    SEAM_SCOPED_TIMER("insert");
+    CV_Assert(input.data != output.data || input.empty());
+    CV_Assert(verticalSeams.size() <= static_cast<size_t>(input.cols));
+    CV_Assert(horizontalSeams.size() <= static_cast<size_t>(input.rows));
+    std::vector<int> insertedColumns, insertedRows;
+    sortRemovedColumns(verticalSeams, input.rows, input.cols, insertedColumns);
+    mapHorizontalSeams(horizontalSeams, insertedColumns, verticalSeams.size(), input.rows, input.cols, insertedRows,
+                       true);
+    if (horizontalSeams.empty()) {
+        ::insertSeamsVertical(input, output, insertedColumns, verticalSeams.size());
+    } else if (verticalSeams.empty()) {
+        ::insertSeamsHorizontal(input, output, insertedRows, horizontalSeams.size());
+    } else {
+        cv::Mat widened;
+        ::insertSeamsVertical(input, widened, insertedColumns, verticalSeams.size());
+        ::insertSeamsHorizontal(widened, output, insertedRows, horizontalSeams.size());
+    }
+}
+
+void seam::insertSeamsVertical(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& seams)
+{
+    insertSeams(input, output, seams, std::vector<std::vector<int>>());
+}
+
+void seam::insertSeamsHorizontal(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& seams)
+{
+    insertSeams(input, output, std::vector<std::vector<int>>(), seams);
 }
 
 void seam::combineVerticalHorizontalSeams(const std::vector<std::vector<int>>& verticalSeams,
                                             std::vector<std::vector<int>>& horizontalSeams)
 {
-    const int newNCols = horizontalSeams[0].size() - verticalSeams.size();
-    for (auto& horizontalSeam : horizontalSeams) {
-        int offset = 0;
-        for (int col = 0; col < newNCols; col++) {
-            if (col >= verticalSeams[offset].at(horizontalSeam[col])) /* horizontal seam crossed another vertical seam */
-                offset++;
-            horizontalSeam[col] = horizontalSeam[col + offset]; /* skip columns with crossed vertical seams */
-        }
-        /* update length */
-        horizontalSeam.erase(horizontalSeam.begin() + newNCols, horizontalSeam.end());
-    }
+    SEAM_SCOPED_TIMER("delete.combine");
+    if (horizontalSeams.empty() || verticalSeams.empty())
+        return;
+    const int nrows = static_cast<int>(verticalSeams[0].size());
+    const int ncols = static_cast<int>(horizontalSeams[0].size());
+    const int newNCols = ncols - static_cast<int>(verticalSeams.size());
+    const size_t nseams = horizontalSeams.size();
+    std::vector<int> removedColumns, removedRows;
+    sortRemovedColumns(verticalSeams, nrows, ncols, removedColumns);
+    mapHorizontalSeams(horizontalSeams, removedColumns, verticalSeams.size(), nrows, ncols, removedRows);
 
+    /* the rows are sorted per column, so the k-th seam takes the k-th row of every column */
+    for (size_t s = 0; s < nseams; s++) {
+        horizontalSeams[s].resize(newNCols);
+        for (int j = 0; j < newNCols; j++)
+            horizontalSeams[s][j] = removedRows[j * nseams + s];
+    }
 }
@@ -2,11 +2,14 @@
 #define SEAMFUNCTIONS_H
 
 #include <vector>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 
-#include "QtOpencvCore.hpp"
+#include "SeamContext.hpp"
+#include "SeamPyramid.hpp"
 #include "opencv2/core/core.hpp"
-#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
 
 namespace seam {
     /**
@@ -16,10 +19,76 @@ namespace seam {
      * @param Result - gradients in x and y directions.
      * 
      * @details The function computes the energy function by calculating the gradients
-     * in x and y directions and saving their sum in Result.
+     * in x and y directions and saving the sum of their absolute values in Result. Both gradients
+     * are computed in a single pass, the rows are processed in parallel.
      */
     void sobel(const cv::Mat& myImage, cv::Mat& Result);
 
+    /**
+     * @brief Computes the Scharr operator for the image myImage and saves it in Result.
+     * @param myImage
+     * @param Result - gradients in x and y directions.
+     *
+     * @details Same as sobel(), but with the more rotation invariant Scharr kernel. The values are scaled
+     * to the same range as those of the Sobel operator.
+     */
+    void scharr(const cv::Mat& myImage, cv::Mat& Result);
+
+    /**
+     * @brief Computes the forward energy costs of a grayscale image for vertical seams.
+     * @param grayscaleImage
+     * @param Result - image of type CV_8UC3 with the costs C_L, C_U and C_R of every pixel.
+     *
+     * @details Forward energy (Rubinstein et al.) measures the energy, which is inserted into the image by
+     * removing a pixel. It depends on the direction the seam continues in, so every pixel has three costs.
+     */
+    void forwardEnergy(const cv::Mat& grayscaleImage, cv::Mat& Result);
+
+    /**
+     * @brief Converts an image to the 8 bit grayscale image the energy functions work on.
+     * @param image - image with 1, 3 (BGR) or 4 (BGRA) channels of depth CV_8U, CV_16U, CV_32F or CV_64F.
+     * @param result - image of type CV_8UC1.
+     *
+     * @details 16 bit images are scaled to 8 bit, floating point images are scaled so that 1 or their maximum,
+     * if it is larger, becomes 255. The conversion is specialized at compile time for every depth and number of
+     * channels, 8 bit images are converted by OpenCV.
+     */
+    void grayscale(const cv::Mat& image, cv::Mat& result);
+
+    /**
+     * @brief The energy functions, which can be used to compute seams.
+     */
+    enum EnergyFunction {
+        ENERGY_SOBEL,
+        ENERGY_SCHARR,
+        ENERGY_FORWARD
+    };
+
+    /**
+     * @brief Values of a mask, which marks pixels to protect from or to remove by the seams.
+     */
+    enum MaskValue {
+        MASK_NONE = 0,
+        MASK_PROTECT = 1,
+        MASK_REMOVE = 2
+    };
+
+    /**
+     * @brief Computes the energy of an image, on which the seams are computed.
+     * @param image - image of any type supported by grayscale(), colour images are converted to grayscale.
+     * @param result - CV_8UC1 for sobel and scharr, CV_8UC3 with the three costs of every pixel for forward energy.
+     * @param function - the energy function.
+     * @param mask - optional CV_8UC1 image with MaskValue entries. Protected pixels get the highest energy,
+     *        pixels to remove the lowest. This only shows the mask, the seam functions apply it to their
+     *        costs, see SeamContext::setMask().
+     * @param horizontal - compute the energy for horizontal seams. Only makes a difference for forward energy.
+     *
+     * @details The seam functions are specialized at compile time for one and three channels, so the energy
+     * function does not add any dispatch to the dynamic programming.
+     */
+    void energy(const cv::Mat& image, cv::Mat& result, EnergyFunction function = ENERGY_SOBEL,
+                const cv::Mat& mask = cv::Mat(), bool horizontal = false);
+
     /**
      * @brief Computes the seam in vertical direction with the lowest sum of energy.
      * @param gradientImage - the energy values of a picture.
@@ -34,6 +103,28 @@ namespace seam {
      */
     std::vector<int> seamVertical(cv::Mat& gradientImage, std::vector<std::vector<bool>>& blockedPixels);
 
+    /**
+     * @brief Computes the seam in vertical direction with the lowest sum of energy.
+     * @param gradientImage - the energy values of a picture.
+     * @param context - working memory with the blocked pixels and the mask, rows() and cols() have to match
+     *        the image.
+     * @param result - the seam in vertical direction, the column of every row. Empty if no seam was found.
+     * @param cost - optionally returns the energy sum of the seam, i.e. the sum of the costs of its pixels,
+     *        which the dynamic programming minimized, including the mask.
+     * @return false, if all pixels are blocked and no seam can be computed.
+     *
+     * @details Same as above, but all working memory is owned by the context, so computing many seams
+     * on the same image does not allocate memory. The pixels of the seam are blocked in the context.
+     * With a mask in the context, seams avoid protected pixels and run through pixels to remove wherever
+     * they can.
+     * Rows of at least 4096 columns are split into stripes, which are computed on all threads of OpenCV.
+     * The energy sums are kept in the context, and after blocking the seam only the ones below it, which
+     * changed, are updated, so only the first seam computes all of them. The gradient image must not be
+     * modified otherwise until the context was reset, see SeamContext::energySource().
+     */
+    bool seamVertical(cv::Mat& gradientImage, SeamContext& context, std::vector<int>& result,
+                      uint32_t* cost = nullptr);
+
     /**
      * @brief Computes the seam in horizontal direction with the lowest sum of energy.
      * @param gradientImage - the energy values of a picture.
@@ -47,15 +138,252 @@ namespace seam {
      * the vector.
      */
     std::vector<int> seamHorizontal(cv::Mat& gradientImage, std::vector<std::vector<bool>>& blockedPixels);
+
+    /**
+     * @brief Computes the seam in horizontal direction with the lowest sum of energy.
+     * @param gradientImage - the energy values of a picture.
+     * @param context - working memory with the blocked pixels. The rows of the context are the columns
+     *        of the image, so rows() has to match the number of columns and cols() the number of rows.
+     * @param result - the seam in horizontal direction, the row of every column. Empty if no seam was found.
+     * @param cost - optionally returns the energy sum of the seam, see seamVertical().
+     * @return false, if all pixels are blocked and no seam can be computed.
+     *
+     * @details The gradient image is transposed, so horizontal seams are computed by the same row-major
+     * dynamic programming as vertical seams. The transposed image is kept in the context and updated together
+     * with the gradient image, so it is only transposed again after the context was reset. The gradient image
+     * must not be modified otherwise until then.
+     */
+    bool seamHorizontal(cv::Mat& gradientImage, SeamContext& context, std::vector<int>& result,
+                        uint32_t* cost = nullptr);
     
+    /**
+     * @brief Computes the seam in vertical direction coarse to fine on an image pyramid, for very large images.
+     * @param gradientImage - the energy values of a picture.
+     * @param context - like for seamVertical() above.
+     * @param pyramid - coarser levels of the gradient image. Built on the first seam of a gradient image and
+     *        updated with every seam, so it has to be cleared, if the gradient image is modified otherwise.
+     * @param result - the seam in vertical direction, the column of every row. Empty if no seam was found.
+     * @return false, if all pixels are blocked and no seam can be computed.
+     *
+     * @details The seam is searched on the coarsest level only, and then refined on every finer level inside
+     * a corridor around the seam of the coarser level, see SeamPyramid. At full resolution the energy sums
+     * of 2 * pyramid.corridor() + 2 columns per row are computed instead of all of them. The seam is the one
+     * with the lowest energy inside the corridor, which is usually but not always the lowest of the image.
+     * If earlier seams block the corridor, the full image is searched.
+     */
+    bool seamVertical(cv::Mat& gradientImage, SeamContext& context, SeamPyramid& pyramid, std::vector<int>& result);
+
+    /**
+     * @brief Computes the seam in horizontal direction coarse to fine, see seamVertical() with a pyramid.
+     * @param gradientImage - the energy values of a picture.
+     * @param context - like for seamHorizontal() above.
+     * @param pyramid - coarser levels of the transposed gradient image.
+     * @param result - the seam in horizontal direction, the row of every column. Empty if no seam was found.
+     * @return false, if all pixels are blocked and no seam can be computed.
+     */
+    bool seamHorizontal(cv::Mat& gradientImage, SeamContext& context, SeamPyramid& pyramid, std::vector<int>& result);
+
+    /**
+     * @brief Computes the seam in vertical direction close to a guide seam, e.g. the same seam of the previous
+     * frame of a video.
+     * @param gradientImage - the energy values of a picture.
+     * @param context - like for seamVertical() above.
+     * @param guide - a vertical seam of an image of the same size, with one column per row.
+     * @param corridor - the number of columns searched on either side of the guide.
+     * @param result - the seam in vertical direction, the column of every row. Empty if no seam was found.
+     * @return false, if all pixels are blocked and no seam can be computed.
+     *
+     * @details Only the energy sums of 2 * corridor + 1 columns per row around the guide are computed, so the
+     * seam can't move further than corridor columns from it and the cost doesn't depend on the width of the
+     * image. If earlier seams block the corridor, the full image is searched.
+     */
+    bool seamVertical(cv::Mat& gradientImage, SeamContext& context, const std::vector<int>& guide, int corridor,
+                      std::vector<int>& result);
+
+    /**
+     * @brief Computes the seam in horizontal direction close to a guide seam, see seamVertical() with a guide.
+     * @param gradientImage - the energy values of a picture.
+     * @param context - like for seamHorizontal() above.
+     * @param guide - a horizontal seam of an image of the same size, with one row per column.
+     * @param corridor - the number of rows searched on either side of the guide.
+     * @param result - the seam in horizontal direction, the row of every column. Empty if no seam was found.
+     * @return false, if all pixels are blocked and no seam can be computed.
+     */
+    bool seamHorizontal(cv::Mat& gradientImage, SeamContext& context, const std::vector<int>& guide, int corridor,
+                        std::vector<int>& result);
+
+    /**
+     * @brief Computes the seam in vertical direction, which starts in the given column of the first row, e.g.
+     * to continue a seam of the band of rows above.
+     * @param gradientImage - the energy values of a picture.
+     * @param context - like for seamVertical() above.
+     * @param start - the column of the seam in the first row.
+     * @param limit - the seam stays left of this column, e.g. to leave room for the seams right of it.
+     * @param result - the seam in vertical direction, the column of every row. Empty if no seam was found.
+     * @return false, if the blocked pixels leave no seam, which starts in that column.
+     *
+     * @details Only the energy sums of the cone below the start, which the seam can reach, are computed, so a
+     * seam through n rows costs about n^2 whatever the width of the image.
+     */
+    bool seamVertical(cv::Mat& gradientImage, SeamContext& context, int start, int limit, std::vector<int>& result);
+
+    /**
+     * @brief Transposes an image with a cache-oblivious blocked algorithm.
+     * @param input
+     * @param output - the transposed image, must not share memory with input.
+     *
+     * @details The image is split recursively along its larger side, until the blocks fit into the cache.
+     * The blocks are then transposed directly, so both reading and writing stay within a few cache lines.
+     */
+    void transpose(const cv::Mat& input, cv::Mat& output);
+
+    /**
+     * @brief Reports the progress of the functions, which remove seams one at a time, and cancels them.
+     *
+     * @details The callbacks are called on the thread, which carves the image, between two seams. The caller
+     * knows how many seams it asked for, so it counts them itself, also over several carves.
+     */
+    struct CarveProgress {
+        /** Called after every removed seam. Returns false to cancel the carve. May be empty. */
+        std::function<bool()> seamRemoved;
+
+        /** Called with the image carved so far every previewInterval seams, the image is only valid during
+         *  the call. May be empty. */
+        std::function<void(const cv::Mat& image)> preview;
+
+        /** Removed seams between two previews, 0 for no previews. */
+        int previewInterval = 0;
+    };
+
+    /**
+     * @brief Downscale an image in vertical direction by removing the seam with the lowest energy one at a time.
+     * @param input - image of type CV_8UC1 or CV_8UC3.
+     * @param output - The matrix image where the down-scaled image is saved in.
+     * @param numberOfSeams - number of columns to remove.
+     * @param function - the energy function.
+     * @param mask - optional mask with MaskValue entries, see energy().
+     *
+     * @details In contrast to computing all seams on the same gradients, the energy is updated after every
+     * removed seam. Only the energy next to the removed seam and the energy sums depending on it are
+     * recomputed, which is much cheaper than recomputing the whole image.
+     */
+    void carveVertical(const cv::Mat& input, cv::Mat& output, int numberOfSeams,
+                       EnergyFunction function = ENERGY_SOBEL, const cv::Mat& mask = cv::Mat());
+
+    /**
+     * @brief Downscale an image in horizontal direction by removing the seam with the lowest energy one at a time.
+     * @param input - image of type CV_8UC1 or CV_8UC3.
+     * @param output - The matrix image where the down-scaled image is saved in.
+     * @param numberOfSeams - number of rows to remove.
+     * @param function - the energy function.
+     * @param mask - optional mask with MaskValue entries, see energy().
+     */
+    void carveHorizontal(const cv::Mat& input, cv::Mat& output, int numberOfSeams,
+                         EnergyFunction function = ENERGY_SOBEL, const cv::Mat& mask = cv::Mat());
+
+    /**
+     * @brief Downscale an image in both directions by removing seams one at a time, first the vertical ones.
+     * @param input - image of type CV_8UC1 or CV_8UC3.
+     * @param output - The matrix image where the down-scaled image is saved in.
+     * @param colsToRemove - number of columns to remove.
+     * @param rowsToRemove - number of rows to remove.
+     * @param function - the energy function.
+     * @param mask - optional mask with MaskValue entries, see energy().
+     * @param progress - optional, is told about every removed seam.
+     * @return false, if progress cancelled the carve. The output then has the seams removed so far.
+     */
+    bool carve(const cv::Mat& input, cv::Mat& output, int colsToRemove, int rowsToRemove,
+               EnergyFunction function = ENERGY_SOBEL, const cv::Mat& mask = cv::Mat(),
+               CarveProgress* progress = nullptr);
+
+    /**
+     * @brief Finds the order of vertical and horizontal seam removals with the lowest total energy.
+     * @param input - image like for carve().
+     * @param order - receives colsToRemove + rowsToRemove entries, true for a vertical and false for a
+     * horizontal seam, in the order of removal.
+     * @param colsToRemove - number of columns to remove.
+     * @param rowsToRemove - number of rows to remove.
+     * @param function - the energy function.
+     * @param mask - optional mask with MaskValue entries, see energy().
+     *
+     * @details This is the transport map of Avidan and Shamir: the cell (r, c) holds the lowest energy of
+     * removing r rows and c columns, which is the cheaper of removing a horizontal seam from the image of cell
+     * (r - 1, c) and a vertical seam from the image of cell (r, c - 1). A cell only depends on the previous
+     * anti-diagonal, so the cells of an anti-diagonal are computed in parallel, and only the images of two
+     * anti-diagonals are kept. Every cell computes a seam of each direction on its own image, so the cost grows
+     * with (colsToRemove + 1) * (rowsToRemove + 1).
+     */
+    void optimalSeamOrder(const cv::Mat& input, std::vector<bool>& order, int colsToRemove, int rowsToRemove,
+                          EnergyFunction function = ENERGY_SOBEL, const cv::Mat& mask = cv::Mat());
+
+    /**
+     * @brief Downscale an image in both directions by removing seams one at a time in the order with the
+     * lowest total energy, see optimalSeamOrder().
+     * @param input - image like for carve().
+     * @param output - The matrix image where the down-scaled image is saved in.
+     * @param colsToRemove - number of columns to remove.
+     * @param rowsToRemove - number of rows to remove.
+     * @param function - the energy function.
+     * @param mask - optional mask with MaskValue entries, see energy().
+     * @param progress - optional, is told about every removed seam. The order is searched before the first
+     *        seam is removed, so it can only cancel after the search.
+     * @return false, if progress cancelled the carve. The output then has the seams removed so far.
+     */
+    bool carveOptimal(const cv::Mat& input, cv::Mat& output, int colsToRemove, int rowsToRemove,
+                      EnergyFunction function = ENERGY_SOBEL, const cv::Mat& mask = cv::Mat(),
+                      CarveProgress* progress = nullptr);
+
+    /**
+     * @brief Value of a removal order map for pixels, which are not removed by any of the seams.
+     */
+    const uint16_t REMOVAL_ORDER_KEPT = UINT16_MAX;
+
+    /**
+     * @brief Removes vertical seams one at a time like carveVertical() and records, which seam removed which pixel.
+     * @param input - image like for carveVertical(), with fewer than REMOVAL_ORDER_KEPT columns.
+     * @param order - CV_16UC1 map of the size of the input, which receives the index of the seam, that removed
+     * the pixel, or REMOVAL_ORDER_KEPT.
+     * @param numberOfSeams - number of columns to remove.
+     * @param function - the energy function.
+     * @param mask - optional mask with MaskValue entries, see energy().
+     * @param progress - optional, is told about every removed seam.
+     * @return false, if progress cancelled the carve. The pixels of the seams, which weren't removed, are kept.
+     *
+     * @details Every row contains each index below numberOfSeams exactly once, so the pixels with an index
+     * of at least n are the image carveVertical() returns for n seams. See SeamMap.
+     */
+    bool removalOrderVertical(const cv::Mat& input, cv::Mat& order, int numberOfSeams,
+                              EnergyFunction function = ENERGY_SOBEL, const cv::Mat& mask = cv::Mat(),
+                              CarveProgress* progress = nullptr);
+
+    /**
+     * @brief Removes horizontal seams one at a time like carveHorizontal() and records, which seam removed which
+     * pixel. Every column contains each index below numberOfSeams exactly once, see removalOrderVertical().
+     */
+    bool removalOrderHorizontal(const cv::Mat& input, cv::Mat& order, int numberOfSeams,
+                                EnergyFunction function = ENERGY_SOBEL, const cv::Mat& mask = cv::Mat(),
+                                CarveProgress* progress = nullptr);
+
+    /**
+     * @brief Downscale an image by removing vertical and horizontal seams in one pass.
+     * @param input - image of any type.
+     * @param output - The matrix image where the down-scaled image is saved in, must not share data with input.
+     * @param verticalSeams - seams in vertical direction, in any order, with one column per row.
+     * @param horizontalSeams - seams in horizontal direction, in any order, with one row per column.
+     *
+     * @details Both kinds of seams are expected to be computed on the input, like seamVertical() and
+     * seamHorizontal() do, so seams of the same kind don't share a pixel. The horizontal seams are mapped onto
+     * the image with the vertical seams removed, see combineVerticalHorizontalSeams(). The output is then
+     * written row by row, copying the runs of kept pixels directly from the input without an intermediate image.
+     */
+    void deleteSeams(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& verticalSeams,
+                     const std::vector<std::vector<int>>& horizontalSeams);
+
     /**
      * @brief Downscale an image in vertical direction using the provided seams.
      * @param input
      * @param output - The matrix image where the down-scaled image is saved in.
-     * @param verticalSeams The seams in vertical direction which have to be removed -
-     * 		  ensure they are sorted
-     * 
-     * @details 
+     * @param verticalSeams The seams in vertical direction which have to be removed, in any order.
      */
     void deleteSeamsVertical(const cv::Mat& input, cv::Mat& output, 
                              const std::vector<std::vector<int>>& verticalSeams);
@@ -63,19 +391,53 @@ namespace seam {
      * @brief Downscale an image in horizontal direction using the provided seams.
      * @param input
      * @param output - The matrix image where the downscaled image is saved in.
-     * @param verticalSeams The seams in horizontal direction which have to be removed -
-     * 		  ensure they are sorted
-     * 
+     * @param horizontalSeams The seams in horizontal direction which have to be removed, in any order.
      */
     void deleteSeamsHorizontal(const cv::Mat& input, cv::Mat& output, 
+                             const std::vector<std::vector<int>>& horizontalSeams);
+
+    /**
+     * @brief Upscale an image by inserting vertical and horizontal seams, the inverse of deleteSeams().
+     * @param input - image of any type.
+     * @param output - The matrix image where the upscaled image is saved in, must not share data with input.
+     * @param verticalSeams - seams in vertical direction, in any order, with one column per row.
+     * @param horizontalSeams - seams in horizontal direction, in any order, with one row per column.
+     *
+     * @details The seams are expected to be computed on the input like for deleteSeams(). Every seam pixel is
+     * replaced by the average with its left (upper) neighbour followed by the average with its right (lower)
+     * neighbour. Each direction is written in one pass into a single allocation, with the output position
+     * of every pixel given by the number of seams before it in its row (column).
+     */
+    void insertSeams(const cv::Mat& input, cv::Mat& output, const std::vector<std::vector<int>>& verticalSeams,
+                     const std::vector<std::vector<int>>& horizontalSeams);
+
+    /**
+     * @brief Upscale an image in vertical direction using the provided seams, see insertSeams().
+     * @param input
+     * @param output - The matrix image where the upscaled image is saved in.
+     * @param verticalSeams The seams in vertical direction which have to be duplicated, in any order.
+     */
+    void insertSeamsVertical(const cv::Mat& input, cv::Mat& output,
                              const std::vector<std::vector<int>>& verticalSeams);
 
+    /**
+     * @brief Upscale an image in horizontal direction using the provided seams, see insertSeams().
+     * @param input
+     * @param output - The matrix image where the upscaled image is saved in.
+     * @param horizontalSeams The seams in horizontal direction which have to be duplicated, in any order.
+     */
+    void insertSeamsHorizontal(const cv::Mat& input, cv::Mat& output,
+                               const std::vector<std::vector<int>>& horizontalSeams);
+
     /**
      * @brief Adjust horizontal seams based on vertical seams, which were calculated on the same picture.
      * @param verticalSeams
-     * @param horizontalSeams
-     * @attention This method has it flaws, if single horizontal and vertical seams have long overlapping parts, for
-     * 			  a vertical seam and horizontal seam which both go from the top left to the bottom right.
+     * @param horizontalSeams - replaced by the seams for the image with the vertical seams removed.
+     *
+     * @details Every pixel of a horizontal seam, which is not part of a vertical seam, is moved to its column
+     * in the narrower image, columns without such a pixel take the row of their left neighbour. Where two seams
+     * would remove the same pixel, one of them is moved to the next row, so that the seams stay disjoint. The
+     * seams are returned in ascending order.
      */
     void combineVerticalHorizontalSeams(const std::vector<std::vector<int>>& verticalSeams,
                                           std::vector<std::vector<int>>& horizontalSeams);
@@ -0,0 +1,317 @@
+#include "SeamMap.hpp"
+#include "Instrumentation.hpp"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+    /* half the number of orders around the expected threshold, which are counted per column */
+    const int THRESHOLD_WINDOW = 64;
+
+    /* columns of a block, which is processed by one thread */
+    const int COLUMN_BLOCK = 512;
+
+    /**
+     * @brief Calls body(blockBegin, blockEnd) for the blocks of COLUMN_BLOCK columns in parallel.
+     */
+    template <typename Body>
+    void forColumnBlocks(int ncols, const Body& body)
+    {
+        cv::parallel_for_(cv::Range(0, (ncols + COLUMN_BLOCK - 1) / COLUMN_BLOCK), [&](const cv::Range& blocks) {
+            for (int b = blocks.start; b < blocks.end; b++)
+                body(b * COLUMN_BLOCK, std::min((b + 1) * COLUMN_BLOCK, ncols));
+        });
+    }
+
+    /**
+     * @brief Copies the pixels of every row, whose order is at least n, and the same elements of follow.
+     * @param output - must have the rows of the input and as many columns as there are such pixels per row.
+     * @param follow - null or a CV_16UC1 matrix of the size of the input, e.g. the other order, whose
+     * elements are copied to followOutput in the same pass.
+     */
+    struct KeepPixels {
+        template <size_t N>
+        static void run(size_t pixelSize, const cv::Mat& input, const cv::Mat& order, int n, cv::Mat& output,
+                        const cv::Mat* follow, cv::Mat* followOutput)
+        {
+            /* the rows are independent of each other */
+            cv::parallel_for_(cv::Range(0, input.rows), [&](const cv::Range& rows) {
+                for (int i = rows.start; i < rows.end; i++) {
+                    const uchar* inputRow = input.ptr<uchar>(i);
+                    const uint16_t* orderRow = order.ptr<uint16_t>(i);
+                    uchar* outputPixel = output.ptr<uchar>(i);
+                    const uint16_t* followRow = follow ? follow->ptr<uint16_t>(i) : nullptr;
+                    uint16_t* followPixel = follow ? followOutput->ptr<uint16_t>(i) : nullptr;
+                    for (int j = 0; j < input.cols; j++) {
+                        if (orderRow[j] < n)
+                            continue;
+                        std::memcpy(outputPixel, inputRow + j * pixelSize, N > 0 ? N : pixelSize);
+                        outputPixel += pixelSize;
+                        if (followRow)
+                            *followPixel++ = followRow[j];
+                    }
+                }
+            });
+        }
+    };
+
+    /**
+     * @brief Drops the pixels of every column, whose order is below the threshold of the column, and the first
+     * ties[j] pixels with an order equal to it. The kept pixels move up by the number of pixels dropped above them.
+     */
+    struct DropPixels {
+        template <size_t N>
+        static void run(size_t pixelSize, const cv::Mat& input, const cv::Mat& order, const std::vector<int>& threshold,
+                        std::vector<int>& ties, std::vector<int>& outputRows, cv::Mat& output)
+        {
+            outputRows.assign(input.cols, 0);
+            /* the columns are independent of each other, a block of them shares the cache lines of each row */
+            forColumnBlocks(input.cols, [&](int blockBegin, int blockEnd) {
+                for (int i = 0; i < input.rows; i++) {
+                    const uchar* inputRow = input.ptr<uchar>(i);
+                    const uint16_t* orderRow = order.ptr<uint16_t>(i);
+                    for (int j = blockBegin; j < blockEnd; j++) {
+                        if (orderRow[j] < threshold[j] || (orderRow[j] == threshold[j] && ties[j]-- > 0))
+                            continue;
+                        std::memcpy(output.ptr<uchar>(outputRows[j]++) + j * pixelSize, inputRow + j * pixelSize,
+                                    N > 0 ? N : pixelSize);
+                    }
+                }
+            });
+        }
+    };
+
+    /**
+     * @brief Runs an operation with the pixel size as template argument, so that the pixels are copied with
+     * a constant size. Sizes without a specialization use 0.
+     */
+    template <typename Operation, typename... Args>
+    void forPixelSize(size_t pixelSize, Args&&... args)
+    {
+        switch (pixelSize) {
+        case 1:
+            Operation::template run<1>(pixelSize, std::forward<Args>(args)...);
+            break;
+        case 2:
+            Operation::template run<2>(pixelSize, std::forward<Args>(args)...);
+            break;
+        case 3:
+            Operation::template run<3>(pixelSize, std::forward<Args>(args)...);
+            break;
+        case 4:
+            Operation::template run<4>(pixelSize, std::forward<Args>(args)...);
+            break;
+        case 6:
+            Operation::template run<6>(pixelSize, std::forward<Args>(args)...);
+            break;
+        case 8:
+            Operation::template run<8>(pixelSize, std::forward<Args>(args)...);
+            break;
+        case 12:
+            Operation::template run<12>(pixelSize, std::forward<Args>(args)...);
+            break;
+        default:
+            Operation::template run<0>(pixelSize, std::forward<Args>(args)...);
+        }
+    }
+
+    /**
+     * @brief Finds for every column the threshold, below which its n pixels with the lowest order are.
+     * @param ties - the number of pixels with an order equal to the threshold, which have to be dropped too.
+     *
+     * @details A column of the full size image contains each order below n exactly once, so after removing
+     * vertical seams most columns still have n orders below n, and the others only a few more or less. The
+     * orders in a window around n are counted per column in the same pass, which finds the threshold of these
+     * columns. Columns without it in the window are sorted partially.
+     */
+    void columnThresholds(const cv::Mat& order, int n, std::vector<int>& threshold, std::vector<int>& ties,
+                          seam::SeamMap::RetargetContext& context)
+    {
+        const int ncols = order.cols, windowBegin = n - THRESHOLD_WINDOW;
+        std::vector<int>& below = context.below;
+        std::vector<int>& window = context.window;
+        below.assign(ncols, 0);
+        window.assign(static_cast<size_t>(ncols) * 2 * THRESHOLD_WINDOW, 0);
+        context.values.resize(static_cast<size_t>(order.rows) * ((ncols + COLUMN_BLOCK - 1) / COLUMN_BLOCK));
+
+        forColumnBlocks(ncols, [&](int blockBegin, int blockEnd) {
+            for (int i = 0; i < order.rows; i++) {
+                const uint16_t* orderRow = order.ptr<uint16_t>(i);
+                for (int j = blockBegin; j < blockEnd; j++) {
+                    below[j] += orderRow[j] < n;
+                    const unsigned bin = static_cast<unsigned>(orderRow[j] - windowBegin);
+                    if (bin < 2 * THRESHOLD_WINDOW)
+                        window[j * 2 * THRESHOLD_WINDOW + bin]++;
+                }
+            }
+
+            /* every block sorts its columns in its own part of the values */
+            uint16_t* values = &context.values[static_cast<size_t>(order.rows) * (blockBegin / COLUMN_BLOCK)];
+            for (int j = blockBegin; j < blockEnd; j++) {
+                const int* bins = &window[j * 2 * THRESHOLD_WINDOW];
+                ties[j] = 0;
+                /* count is the number of orders below windowBegin + bin, move bin until it is n or just above */
+                int count = below[j], bin = THRESHOLD_WINDOW;
+                while (count > n && bin > 0 && count - bins[bin-1] >= n)
+                    count -= bins[--bin];
+                while (count < n && bin < 2 * THRESHOLD_WINDOW && count + bins[bin] <= n)
+                    count += bins[bin++];
+                if (count == n) {
+                    threshold[j] = windowBegin + bin;
+                } else if (count > n && bin > 0) {
+                    threshold[j] = windowBegin + bin - 1;
+                    ties[j] = n - (count - bins[bin-1]);
+                } else if (count < n && bin < 2 * THRESHOLD_WINDOW) {
+                    threshold[j] = windowBegin + bin;
+                    ties[j] = n - count;
+                } else {
+                    for (int i = 0; i < order.rows; i++)
+                        values[i] = order.at<uint16_t>(i, j);
+                    std::nth_element(values, values + n - 1, values + order.rows);
+                    threshold[j] = values[n-1];
+                    ties[j] = n - static_cast<int>(std::count_if(values, values + order.rows,
+                            [&](uint16_t value) { return value < threshold[j]; }));
+                }
+            }
+        });
+    }
+} // namespace
+
+seam::SeamMap::SeamMap() : function(ENERGY_SOBEL), verticalCount(0), horizontalCount(0)
+{
+}
+
+bool seam::SeamMap::compute(const cv::Mat& input, EnergyFunction energyFunction, const cv::Mat& mask,
+                            CarveProgress* progress)
+{
+    SEAM_SCOPED_TIMER("seammap.compute");
+    CV_Assert(input.rows >= 3 && input.cols >= 3);
+    CV_Assert(input.rows < REMOVAL_ORDER_KEPT && input.cols < REMOVAL_ORDER_KEPT);
+    /* both directions are carved on the full size image */
+    if (!removalOrderVertical(input, vertical, input.cols - 3, energyFunction, mask, progress) ||
+        !removalOrderHorizontal(input, horizontal, input.rows - 3, energyFunction, mask, progress)) {
+        clear();
+        return false;
+    }
+    image = input.clone();
+    function = energyFunction;
+    verticalCount = input.cols - 3;
+    horizontalCount = input.rows - 3;
+    return true;
+}
+
+void seam::SeamMap::assign(const cv::Mat& input, EnergyFunction energyFunction,
+                           const std::vector<std::vector<int>>& verticalSeams,
+                           const std::vector<std::vector<int>>& horizontalSeams)
+{
+    CV_Assert(!input.empty() && input.rows < REMOVAL_ORDER_KEPT && input.cols < REMOVAL_ORDER_KEPT);
+    CV_Assert(verticalSeams.size() < static_cast<size_t>(input.cols) &&
+              horizontalSeams.size() < static_cast<size_t>(input.rows));
+    vertical.create(input.rows, input.cols, CV_16UC1);
+    vertical.setTo(REMOVAL_ORDER_KEPT);
+    for (size_t k = 0; k < verticalSeams.size(); k++) {
+        const std::vector<int>& seam = verticalSeams[k];
+        CV_Assert(seam.size() == static_cast<size_t>(input.rows));
+        for (int i = 0; i < input.rows; i++) {
+            CV_Assert(seam[i] >= 0 && seam[i] < input.cols);
+            /* seams of the same direction don't share a pixel */
+            uint16_t& order = vertical.at<uint16_t>(i, seam[i]);
+            CV_Assert(order == REMOVAL_ORDER_KEPT);
+            order = static_cast<uint16_t>(k);
+        }
+    }
+    horizontal.create(input.rows, input.cols, CV_16UC1);
+    horizontal.setTo(REMOVAL_ORDER_KEPT);
+    for (size_t k = 0; k < horizontalSeams.size(); k++) {
+        const std::vector<int>& seam = horizontalSeams[k];
+        CV_Assert(seam.size() == static_cast<size_t>(input.cols));
+        for (int j = 0; j < input.cols; j++) {
+            CV_Assert(seam[j] >= 0 && seam[j] < input.rows);
+            uint16_t& order = horizontal.at<uint16_t>(seam[j], j);
+            CV_Assert(order == REMOVAL_ORDER_KEPT);
+            order = static_cast<uint16_t>(k);
+        }
+    }
+    image = input.clone();
+    function = energyFunction;
+    verticalCount = static_cast<int>(verticalSeams.size());
+    horizontalCount = static_cast<int>(horizontalSeams.size());
+}
+
+void seam::SeamMap::seams(std::vector<std::vector<int>>& verticalSeams,
+                          std::vector<std::vector<int>>& horizontalSeams) const
+{
+    verticalSeams.assign(verticalCount, std::vector<int>(image.rows));
+    horizontalSeams.assign(horizontalCount, std::vector<int>(image.cols));
+    for (int i = 0; i < image.rows; i++) {
+        const uint16_t* verticalRow = vertical.ptr<uint16_t>(i);
+        const uint16_t* horizontalRow = horizontal.ptr<uint16_t>(i);
+        for (int j = 0; j < image.cols; j++) {
+            if (verticalRow[j] != REMOVAL_ORDER_KEPT)
+                verticalSeams[verticalRow[j]][i] = j;
+            if (horizontalRow[j] != REMOVAL_ORDER_KEPT)
+                horizontalSeams[horizontalRow[j]][j] = i;
+        }
+    }
+}
+
+void seam::SeamMap::clear()
+{
+    image.release();
+    vertical.release();
+    horizontal.release();
+    verticalCount = 0;
+    horizontalCount = 0;
+}
+
+void seam::SeamMap::setImage(const cv::Mat& newImage)
+{
+    CV_Assert(!empty() && newImage.size() == image.size());
+    image = newImage;
+}
+
+void seam::SeamMap::retarget(int width, int height, cv::Mat& output) const
+{
+    RetargetContext context;
+    retarget(width, height, output, context);
+}
+
+void seam::SeamMap::retarget(int width, int height, cv::Mat& output, RetargetContext& context) const
+{
+    SEAM_SCOPED_TIMER("seammap.retarget");
+    CV_Assert(!empty());
+    CV_Assert(width >= minWidth() && width <= image.cols && height >= minHeight() && height <= image.rows);
+    const int colsToRemove = image.cols - width, rowsToRemove = image.rows - height;
+    /* the output keeps its memory, if it already has the size, e.g. if it points to a buffer of the caller */
+    output.create(height, width, image.type());
+    SEAM_COUNT("bytes_copied", output.total() * output.elemSize());
+    if (rowsToRemove == 0) {
+        if (colsToRemove > 0)
+            forPixelSize<KeepPixels>(image.elemSize(), image, vertical, colsToRemove, output, nullptr, nullptr);
+        else
+            image.copyTo(output);
+        return;
+    }
+
+    /* remove the vertical seams, the horizontal order follows the pixels. The buffers have the full size, so
+     * they are only allocated once, and the used columns are passed on. */
+    cv::Mat narrow = image, narrowOrder = horizontal;
+    if (colsToRemove > 0) {
+        context.narrow.create(image.rows, image.cols, image.type());
+        context.narrowOrder.create(image.rows, image.cols, CV_16UC1);
+        narrow = context.narrow.colRange(0, width);
+        narrowOrder = context.narrowOrder.colRange(0, width);
+        forPixelSize<KeepPixels>(image.elemSize(), image, vertical, colsToRemove, narrow, &horizontal, &narrowOrder);
+    }
+
+    /* Every column drops its rowsToRemove pixels with the lowest horizontal order, ties from top to bottom.
+     * Without vertical seams these are exactly the pixels of the first rowsToRemove horizontal seams. */
+    context.threshold.assign(width, rowsToRemove);
+    context.ties.assign(width, 0);
+    if (colsToRemove > 0)
+        columnThresholds(narrowOrder, rowsToRemove, context.threshold, context.ties, context);
+
+    forPixelSize<DropPixels>(image.elemSize(), narrow, narrowOrder, context.threshold, context.ties,
+                             context.outputRows, output);
+}
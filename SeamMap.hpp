@@ -0,0 +1,126 @@
+#ifndef SEAMMAP_HPP
+#define SEAMMAP_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "SeamFunctions.hpp"
+
+namespace seam {
+    /**
+     * @brief Multi-size representation of an image, which retargets it to any smaller size without computing seams.
+     *
+     * @details compute() carves the image down to three columns and to three rows once and keeps for every
+     * pixel the index of the vertical and of the horizontal seam, which removed it (see removalOrderVertical()).
+     * Removing n seams then means keeping the pixels with an index of at least n, which retarget() does in a
+     * single pass over the pixels.
+     * If only one direction is carved, the result equals carveVertical() or carveHorizontal(). If both are
+     * carved, the horizontal order of the full size image is used on the narrower image: every column drops
+     * the pixels with the lowest horizontal indices, so the removed pixels are close to, but not exactly the
+     * seams carve() would compute.
+     */
+    class SeamMap
+    {
+    public:
+        /**
+         * @brief Working memory of retarget(), which keeps it between sizes, so that retargeting to many sizes,
+         * e.g. while a window is resized, doesn't allocate memory.
+         */
+        struct RetargetContext {
+            cv::Mat narrow;
+            cv::Mat narrowOrder;
+            std::vector<int> threshold;
+            std::vector<int> ties;
+            std::vector<int> below;
+            std::vector<int> window;
+            std::vector<int> outputRows;
+            std::vector<uint16_t> values;
+        };
+
+        SeamMap();
+
+        /**
+         * @brief Computes the removal order of all vertical and horizontal seams of an image.
+         * @param image - image like for carve(), with fewer than REMOVAL_ORDER_KEPT rows and columns.
+         * @param function - the energy function.
+         * @param mask - optional mask with MaskValue entries, see energy().
+         * @param progress - optional, is told about each of the (cols - 3) + (rows - 3) removed seams.
+         * @return false, if progress cancelled the computation. The map is empty then.
+         */
+        bool compute(const cv::Mat& image, EnergyFunction function = ENERGY_SOBEL, const cv::Mat& mask = cv::Mat(),
+                     CarveProgress* progress = nullptr);
+
+        /**
+         * @brief Sets the removal order from seams computed before, e.g. by seams() and stored in a SeamCache.
+         * @param image - the image the seams were computed on.
+         * @param function - the energy function they were computed with.
+         * @param verticalSeams - the vertical seams in the order of removal, with the columns of the image.
+         * @param horizontalSeams - the horizontal seams in the order of removal, with the rows of the image.
+         */
+        void assign(const cv::Mat& image, EnergyFunction function, const std::vector<std::vector<int>>& verticalSeams,
+                    const std::vector<std::vector<int>>& horizontalSeams);
+
+        /**
+         * @brief Returns the removed seams in the order of removal, with the columns and rows of the image.
+         */
+        void seams(std::vector<std::vector<int>>& verticalSeams, std::vector<std::vector<int>>& horizontalSeams) const;
+
+        /**
+         * @brief Releases the image and the removal orders.
+         */
+        void clear();
+
+        /**
+         * @brief Replaces the image by one of the same size, e.g. a copy converted for display. The removal
+         * orders are kept, so retarget() removes the same pixels of it.
+         */
+        void setImage(const cv::Mat& image);
+
+        /**
+         * @brief Retargets the image.
+         * @param width - the width of the output, from minWidth() to the width of the image.
+         * @param height - the height of the output, from minHeight() to the height of the image.
+         * @param output - The matrix image where the retargeted image is saved in. If it already has the size
+         *        and type, its memory is reused, even if it doesn't own it, so it can be a header of a caller's buffer.
+         */
+        void retarget(int width, int height, cv::Mat& output) const;
+
+        /**
+         * @brief Same as above, but reuses the working memory of context.
+         */
+        void retarget(int width, int height, cv::Mat& output, RetargetContext& context) const;
+
+        bool empty() const { return image.empty(); }
+        cv::Size size() const { return image.size(); }
+        int minWidth() const { return image.cols - verticalCount; }
+        int minHeight() const { return image.rows - horizontalCount; }
+        EnergyFunction energyFunction() const { return function; }
+
+        /**
+         * @brief Returns the image, which is retargeted.
+         */
+        const cv::Mat& input() const { return image; }
+
+        /**
+         * @brief Returns the CV_16UC1 removal order of the vertical seams, see removalOrderVertical().
+         */
+        const cv::Mat& verticalOrder() const { return vertical; }
+
+        /**
+         * @brief Returns the CV_16UC1 removal order of the horizontal seams, see removalOrderHorizontal().
+         */
+        const cv::Mat& horizontalOrder() const { return horizontal; }
+
+    private:
+        cv::Mat image;
+        cv::Mat vertical;
+        cv::Mat horizontal;
+        EnergyFunction function;
+        /* number of seams per direction, which have an order */
+        int verticalCount;
+        int horizontalCount;
+    };
+} // namespace seam
+
+#endif // SEAMMAP_HPP
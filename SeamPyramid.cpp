@@ -0,0 +1,73 @@
+#include "SeamPyramid.hpp"
+#include "Instrumentation.hpp"
+
+#include <algorithm>
+#include <climits>
+
+const int seam::SeamPyramid::DEFAULT_CORRIDOR;
+const int seam::SeamPyramid::DEFAULT_MIN_SIZE;
+
+/* halves the rows and columns, every pixel is the maximum of the up to 2x2 pixels it covers */
+static void maxDownsample(const cv::Mat& input, cv::Mat& output)
+{
+    const int channels = input.channels();
+    output.create((input.rows + 1) / 2, (input.cols + 1) / 2, input.type());
+    cv::parallel_for_(cv::Range(0, output.rows), [&](const cv::Range& rows) {
+        for (int i = rows.start; i < rows.end; i++) {
+            const uchar* upper = input.ptr<uchar>(2 * i);
+            const uchar* lower = input.ptr<uchar>(std::min(2 * i + 1, input.rows - 1));
+            uchar* result = output.ptr<uchar>(i);
+            for (int j = 0; j < output.cols; j++) {
+                const int left = 2 * j * channels, right = std::min(2 * j + 1, input.cols - 1) * channels;
+                for (int c = 0; c < channels; c++)
+                    result[j * channels + c] = std::max(std::max(upper[left + c], upper[right + c]),
+                                                        std::max(lower[left + c], lower[right + c]));
+            }
+        }
+    });
+}
+
+seam::SeamPyramid::SeamPyramid(int corridor, int minSize)
+    : corridorWidth(corridor), minSize(minSize), sourceData(nullptr)
+{
+    CV_Assert(corridor >= 0 && minSize >= 3);
+}
+
+void seam::SeamPyramid::build(const cv::Mat& energyImage)
+{
+    SEAM_SCOPED_TIMER("pyramid.build");
+    CV_Assert(energyImage.type() == CV_8UC1 || energyImage.type() == CV_8UC3);
+    int nlevels = 0;
+    for (int rows = energyImage.rows, cols = energyImage.cols; rows / 2 >= minSize && cols / 2 >= minSize;
+         rows = (rows + 1) / 2, cols = (cols + 1) / 2)
+        nlevels++;
+
+    images.resize(nlevels);
+    contexts.resize(nlevels);
+    for (int l = 0; l < nlevels; l++) {
+        maxDownsample(l == 0 ? energyImage : images[l-1], images[l]);
+        contexts[l].reset(images[l].rows, images[l].cols);
+    }
+    sourceData = energyImage.data;
+}
+
+void seam::SeamPyramid::markSeam(const std::vector<int>& seam)
+{
+    for (int l = 0; l < levels(); l++) {
+        cv::Mat& image = images[l];
+        const int channels = image.channels(), shift = l + 1;
+        for (size_t i = 0; i < seam.size(); i++) {
+            const int row = static_cast<int>(i >> shift), col = seam[i] >> shift;
+            uchar* pixel = image.ptr<uchar>(row) + col * channels;
+            std::fill(pixel, pixel + channels, UCHAR_MAX);
+            contexts[l].block(row, col);
+        }
+    }
+}
+
+void seam::SeamPyramid::clear()
+{
+    images.clear();
+    contexts.clear();
+    sourceData = nullptr;
+}
@@ -0,0 +1,75 @@
+#ifndef SEAMPYRAMID_HPP
+#define SEAMPYRAMID_HPP
+
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "SeamContext.hpp"
+
+namespace seam {
+    /**
+     * @brief Coarser versions of an energy image for the coarse-to-fine seam search of seamVertical() and
+     * seamHorizontal() with a pyramid.
+     *
+     * @details Every level halves the rows and columns of the level below by taking the maximum of 2x2 pixels,
+     * so a coarse pixel is only cheap, if all pixels it covers are, and a seam marked with UCHAR_MAX on the
+     * energy image stays marked on every level. Every level has its own context for the dynamic programming,
+     * whose pixels are never blocked. Like the context, the pyramid keeps its memory between seams.
+     */
+    class SeamPyramid
+    {
+    public:
+        /** Columns searched on either side of the seam of the next coarser level. */
+        static const int DEFAULT_CORRIDOR = 4;
+
+        /** Rows and columns the coarsest level has at least. */
+        static const int DEFAULT_MIN_SIZE = 64;
+
+        /**
+         * @param corridor - columns searched on either side of the coarser seam, more columns find seams closer
+         *        to the ones of the full search, fewer are faster.
+         * @param minSize - the coarsest level has at least minSize rows and columns.
+         */
+        explicit SeamPyramid(int corridor = DEFAULT_CORRIDOR, int minSize = DEFAULT_MIN_SIZE);
+
+        /**
+         * @brief Builds the levels of an energy image of type CV_8UC1 or CV_8UC3. Images with fewer than
+         * 2 * minSize rows or columns get no levels.
+         */
+        void build(const cv::Mat& energyImage);
+
+        /**
+         * @brief Marks the pixels of a vertical seam of the energy image with UCHAR_MAX on every level.
+         */
+        void markSeam(const std::vector<int>& seam);
+
+        /**
+         * @brief Releases the levels, so that the next seam builds them again.
+         */
+        void clear();
+
+        int levels() const { return static_cast<int>(images.size()); }
+        int corridor() const { return corridorWidth; }
+
+        /**
+         * @brief Returns a level, level 0 has half the rows and columns of the energy image.
+         */
+        cv::Mat& level(int l) { return images[l]; }
+        SeamContext& context(int l) { return contexts[l]; }
+
+        /**
+         * @brief The energy image, which the levels were built from. Cleared by clear().
+         */
+        const uchar* source() const { return sourceData; }
+        void setSource(const uchar* source) { sourceData = source; }
+
+    private:
+        int corridorWidth;
+        int minSize;
+        std::vector<cv::Mat> images;
+        std::vector<SeamContext> contexts;
+        const uchar* sourceData;
+    };
+} // namespace
+
+#endif // SEAMPYRAMID_HPP
@@ -0,0 +1,151 @@
+#include "SeamWorker.hpp"
+#include "Instrumentation.hpp"
+
+#include <utility>
+
+#include <QtConcurrent>
+
+const int SeamWorker::PREVIEW_INTERVAL;
+
+SeamWorker::SeamWorker(QObject *parent) :
+    QObject(parent), cancelRequested(false), running(false), done(0), total(0)
+{
+    /* cv::Mat is passed by value to the GUI thread */
+    qRegisterMetaType<cv::Mat>("cv::Mat");
+    connect(&watcher, &QFutureWatcher<void>::finished, this, [this] {
+        running = false;
+        emit finished();
+    });
+}
+
+SeamWorker::~SeamWorker()
+{
+    cancel();
+    watcher.waitForFinished();
+}
+
+bool SeamWorker::start(Job job)
+{
+    if (running)
+        return false;
+    current = std::move(job);
+    cancelRequested = false;
+    running = true;
+    done = 0;
+    switch (current.task) {
+    case SEAM_MAP:
+        total = (current.image.cols - 3) + (current.image.rows - 3);
+        break;
+    case REMOVE_SEAMS:
+    case INSERT_SEAMS:
+        /* a single pass without seams to count */
+        total = 0;
+        break;
+    default:
+        total = current.colsToRemove + current.rowsToRemove;
+    }
+    watcher.setFuture(QtConcurrent::run([this] { run(); }));
+    return true;
+}
+
+void SeamWorker::cancel()
+{
+    cancelRequested = true;
+}
+
+bool SeamWorker::seamDone()
+{
+    done++;
+    if (total > 0 && done * 100 / total != (done - 1) * 100 / total)
+        emit progress(done, total);
+    if (!cancelRequested)
+        return true;
+    current.cancelled = true;
+    return false;
+}
+
+void SeamWorker::run()
+{
+    Job& job = current;
+    /* the carves report every removed seam and show the image carved so far */
+    seam::CarveProgress carveProgress;
+    carveProgress.seamRemoved = [this] { return seamDone(); };
+    carveProgress.preview = [this](const cv::Mat& image) { emit preview(QString("Downscaled Image"), image.clone()); };
+    carveProgress.previewInterval = job.previews ? PREVIEW_INTERVAL : 0;
+
+    switch (job.task) {
+    case COMPUTE_SEAMS:
+        computeSeams();
+        break;
+    case CARVE_ITERATIVE:
+        seam::carve(job.image, job.result, job.colsToRemove, job.rowsToRemove, job.function, job.mask, &carveProgress);
+        break;
+    case CARVE_OPTIMAL:
+        seam::carveOptimal(job.image, job.result, job.colsToRemove, job.rowsToRemove, job.function, job.mask,
+                           &carveProgress);
+        break;
+    case SEAM_MAP:
+        job.seamMap.compute(job.image, job.function, job.mask, &carveProgress);
+        break;
+    case REMOVE_SEAMS:
+        seam::deleteSeams(job.image, job.result, job.seamsVertical, job.seamsHorizontal);
+        break;
+    case INSERT_SEAMS:
+        seam::insertSeams(job.image, job.result, job.seamsVertical, job.seamsHorizontal);
+        break;
+    }
+}
+
+void SeamWorker::computeSeams()
+{
+    SEAM_SCOPED_TIMER("worker.computeSeams");
+    Job& job = current;
+    /* Compute energy function. The horizontal seams need their own copy, because the computed seams are
+     * marked on the energy image, and forward energy differs for horizontal seams. */
+    seam::energy(job.image, job.verticalEnergy, job.function, job.mask);
+    seam::energy(job.image, job.horizontalEnergy, job.function, job.mask, true);
+    /* In the beginning, all pixel are not blocked. The context is reused for all seams. The mask is applied
+     * to the costs of the seams. */
+    seam::SeamContext context(job.image.rows, job.image.cols);
+    context.setMask(job.mask);
+    std::vector<int> seam;
+    /* The pyramid search only refines the seams of a smaller image, which is much faster for large images. */
+    seam::SeamPyramid pyramid;
+
+    /* Compute vertical seams and store them. */
+    for (int i = 0; i < job.colsToRemove; i++) {
+        if (!(job.pyramidSearch ? seam::seamVertical(job.verticalEnergy, context, pyramid, seam)
+                                : seam::seamVertical(job.verticalEnergy, context, seam))) {
+            job.verticalBlocked = true;
+            break;
+        }
+        job.seamsVertical.emplace_back(seam);
+        if ((i + 1) % PREVIEW_INTERVAL == 0)
+            emit preview(QString("vertical"), job.verticalEnergy.clone());
+        if (!seamDone())
+            return;
+    }
+    done = job.colsToRemove;
+
+    /* Reset blocked pixels. For horizontal seams the rows of the context are the columns of the image. */
+    context.reset(job.image.cols, job.image.rows);
+    if (!job.mask.empty()) {
+        cv::Mat transposedMask;
+        seam::transpose(job.mask, transposedMask);
+        context.setMask(transposedMask);
+    }
+
+    /* Compute horizontal seams and store them. */
+    for (int i = 0; i < job.rowsToRemove; i++) {
+        if (!(job.pyramidSearch ? seam::seamHorizontal(job.horizontalEnergy, context, pyramid, seam)
+                                : seam::seamHorizontal(job.horizontalEnergy, context, seam))) {
+            job.horizontalBlocked = true;
+            break;
+        }
+        job.seamsHorizontal.emplace_back(seam);
+        if ((i + 1) % PREVIEW_INTERVAL == 0)
+            emit preview(QString("horizontal"), job.horizontalEnergy.clone());
+        if (!seamDone())
+            return;
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef SEAMWORKER_HPP
+#define SEAMWORKER_HPP
+
+#include <atomic>
+#include <vector>
+
+#include <QFutureWatcher>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+
+#include "opencv2/core/core.hpp"
+#include "SeamFunctions.hpp"
+#include "SeamMap.hpp"
+
+Q_DECLARE_METATYPE(cv::Mat)
+
+/**
+ * @brief Runs the seam computations of the main window on a thread of the Qt thread pool.
+ *
+ * @details A job copies the headers of the images, which share the pixels with the main window, and the
+ * worker never modifies them. While a job runs, the worker reports its progress and every PREVIEW_INTERVAL
+ * seams a copy of the image carved so far. Jobs are cancelled cooperatively: the worker stops after the
+ * seam it is computing and keeps what it has done so far, e.g. the seams found or the image carved until then.
+ * Only one job runs at a time. All signals are delivered on the thread of the worker, the GUI thread.
+ */
+class SeamWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** Seams between two previews. */
+    static const int PREVIEW_INTERVAL = 10;
+
+    enum Task {
+        COMPUTE_SEAMS,   /* seams of both directions on the same energy, see seam::seamVertical() */
+        CARVE_ITERATIVE, /* see seam::carve() */
+        CARVE_OPTIMAL,   /* see seam::carveOptimal() */
+        SEAM_MAP,        /* see seam::SeamMap::compute() */
+        REMOVE_SEAMS,    /* see seam::deleteSeams() */
+        INSERT_SEAMS     /* see seam::insertSeams() */
+    };
+
+    /**
+     * @brief Input and result of a job.
+     */
+    struct Job {
+        Task task = COMPUTE_SEAMS;
+        cv::Mat image;
+        cv::Mat mask;
+        seam::EnergyFunction function = seam::ENERGY_SOBEL;
+        int colsToRemove = 0;
+        int rowsToRemove = 0;
+        bool pyramidSearch = false;
+        /* show the image carved so far every PREVIEW_INTERVAL seams, e.g. not for a seam map computed in advance */
+        bool previews = true;
+
+        /* computed by COMPUTE_SEAMS, removed or inserted by REMOVE_SEAMS and INSERT_SEAMS */
+        std::vector<std::vector<int>> seamsVertical;
+        std::vector<std::vector<int>> seamsHorizontal;
+
+        /* the carved image of all tasks but COMPUTE_SEAMS and SEAM_MAP */
+        cv::Mat result;
+        /* the energy of COMPUTE_SEAMS with the seams marked */
+        cv::Mat verticalEnergy;
+        cv::Mat horizontalEnergy;
+        /* COMPUTE_SEAMS found fewer seams than asked for, because the others would cross them */
+        bool verticalBlocked = false;
+        bool horizontalBlocked = false;
+        seam::SeamMap seamMap;
+        bool cancelled = false;
+    };
+
+    explicit SeamWorker(QObject *parent = 0);
+
+    /* Cancels the running job and waits for it. */
+    ~SeamWorker();
+
+    /**
+     * @brief Starts a job on a thread of the pool.
+     * @return false, if a job is still running.
+     */
+    bool start(Job job);
+
+    /**
+     * @brief Asks the running job to stop after the current seam, finished() is still emitted.
+     */
+    void cancel();
+
+    bool isRunning() const { return running; }
+
+    /**
+     * @brief The last job, with its results after finished() was emitted.
+     */
+    Job& job() { return current; }
+
+signals:
+    /* done of total seams, emitted whenever the percentage changes */
+    void progress(int done, int total);
+
+    /* a copy of an intermediate image for the window with the given title */
+    void preview(QString title, cv::Mat image);
+
+    void finished();
+
+private:
+    /* runs the current job on the thread of the pool */
+    void run();
+    void computeSeams();
+
+    /* counts a seam and reports the progress, returns false if the job is cancelled */
+    bool seamDone();
+
+    Job current;
+    QFutureWatcher<void> watcher;
+    std::atomic<bool> cancelRequested;
+    bool running;
+    int done;
+    int total;
+};
+
+#endif // SEAMWORKER_HPP
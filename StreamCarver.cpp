@@ -0,0 +1,245 @@
+#include "StreamCarver.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "ImageReader.hpp"
+#include "Instrumentation.hpp"
+#include "PnmFile.hpp"
+#include "SeamContext.hpp"
+
+namespace {
+    void error(const std::string& message)
+    {
+        std::cerr << "error: " << message << "\n";
+    }
+
+    /**
+     * @brief Reads the rows of an image band by band. Binary PGM and PPM files are read from disk, only the
+     * requested rows are held in memory. Other images are decoded at once.
+     */
+    struct BandReader {
+        std::ifstream file;
+        seam::PnmHeader header;
+        cv::Mat image;
+        cv::Size size;
+        int type = 0;
+
+        bool open(const std::string& path)
+        {
+            if (seam::isPnmPath(path)) {
+                file.open(path, std::ios::binary);
+                if (!file || !seam::readPnmHeader(file, header))
+                    return false;
+                size = cv::Size(header.width, header.height);
+                type = header.type;
+                return true;
+            }
+            image = ImageReader::readImage(path);
+            size = image.size();
+            type = image.type();
+            return !image.empty();
+        }
+
+        /**
+         * @brief Returns the rows [begin, end) in rows, which may share the memory of a decoded image.
+         */
+        bool read(int begin, int end, cv::Mat& rows)
+        {
+            SEAM_SCOPED_TIMER("stream.read");
+            if (!image.empty()) {
+                rows = image.rowRange(begin, end);
+                return true;
+            }
+            rows.create(end - begin, size.width, type);
+            file.seekg(static_cast<std::streamoff>(header.dataOffset + begin * header.rowBytes()));
+            if (!file.read(reinterpret_cast<char*>(rows.data),
+                           static_cast<std::streamsize>((end - begin) * header.rowBytes())))
+                return false;
+            seam::convertPnmRows(rows);
+            return true;
+        }
+    };
+
+    /**
+     * @brief Writes the rows of an image band by band. PGM and PPM files are appended to on disk, other images
+     * are collected and encoded at once by close().
+     */
+    struct BandWriter {
+        std::string path;
+        std::ofstream file;
+        cv::Mat image;
+        cv::Mat converted;
+        int written = 0;
+
+        bool open(const std::string& outputPath, cv::Size size, int type)
+        {
+            path = outputPath;
+            if (!seam::isPnmPath(path)) {
+                image.create(size, type);
+                return true;
+            }
+            if (type != CV_8UC1 && type != CV_8UC3 && type != CV_16UC1 && type != CV_16UC3)
+                return false;
+            file.open(path, std::ios::binary);
+            file << seam::pnmHeader(size.width, size.height, type);
+            return static_cast<bool>(file);
+        }
+
+        bool write(const cv::Mat& rows)
+        {
+            SEAM_SCOPED_TIMER("stream.write");
+            if (!image.empty()) {
+                rows.copyTo(image.rowRange(written, written + rows.rows));
+                written += rows.rows;
+                return true;
+            }
+            /* a continuous copy in the layout of the file */
+            rows.copyTo(converted);
+            seam::convertPnmRows(converted);
+            file.write(reinterpret_cast<const char*>(converted.data),
+                       static_cast<std::streamsize>(converted.total() * converted.elemSize()));
+            written += rows.rows;
+            return static_cast<bool>(file);
+        }
+
+        bool close()
+        {
+            if (!image.empty()) {
+                SEAM_SCOPED_TIMER("stream.write");
+                return cv::imwrite(path, image);
+            }
+            file.close();
+            return !file.fail();
+        }
+    };
+
+    /**
+     * @brief Finds the seams of one band. Without start columns they are searched in the full band, otherwise
+     * the k-th seam starts in the k-th column of the first row.
+     * @param starts - the columns, where the seams of the band above ended, in ascending order. Replaced by
+     *        the columns, where the seams of this band end, in ascending order.
+     * @return false, if the band has fewer seams, which don't cross each other. Only possible without start
+     *         columns.
+     *
+     * @details With start columns the seams are searched from left to right, and the k-th one stays left of
+     * the last count - 1 - k columns. So there always is the seam just right of the one before, which leaves
+     * enough room for the rest.
+     */
+    bool findBandSeams(cv::Mat& energyImage, seam::SeamContext& context, int count, std::vector<int>& starts,
+                       std::vector<std::vector<int>>& seams)
+    {
+        SEAM_SCOPED_TIMER("stream.seams");
+        const int ncols = energyImage.cols;
+        seams.resize(count);
+        for (int k = 0; k < count; k++) {
+            const bool found = starts.empty()
+                    ? seam::seamVertical(energyImage, context, seams[k])
+                    : seam::seamVertical(energyImage, context, starts[k], ncols - (count - 1 - k), seams[k]);
+            if (!found)
+                return false;
+        }
+        starts.resize(count);
+        for (int k = 0; k < count; k++)
+            starts[k] = seams[k].back();
+        std::sort(starts.begin(), starts.end());
+        return true;
+    }
+
+    /**
+     * @brief Returns the count columns of the first row with the lowest energy in ascending order.
+     */
+    std::vector<int> lowestEnergyColumns(const cv::Mat& energyImage, int count)
+    {
+        /* forward energy has three costs per pixel, the one from above is the cost of starting there */
+        const int nChannels = energyImage.channels(), offset = nChannels / 2;
+        const uchar* energy = energyImage.ptr<uchar>(0);
+        std::vector<int> columns(energyImage.cols);
+        for (int j = 0; j < energyImage.cols; j++)
+            columns[j] = j;
+        std::stable_sort(columns.begin(), columns.end(), [&](int a, int b) {
+            return energy[a * nChannels + offset] < energy[b * nChannels + offset];
+        });
+        columns.resize(count);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    }
+} // namespace
+
+bool seam::carveStream(const std::string& inputPath, const std::string& outputPath, const BatchOptions& options)
+{
+    BandReader reader;
+    if (!reader.open(inputPath)) {
+        error("can't read " + inputPath);
+        return false;
+    }
+    const cv::Size size = reader.size;
+    const int colsToRemove = options.cols >= 0 ? options.cols : options.width >= 0 ? size.width - options.width : 0;
+    const bool rowsRemoved = options.rows > 0 || (options.height >= 0 && options.height != size.height);
+    if (colsToRemove < 0 || colsToRemove > size.width - 3 || size.height < 3 || rowsRemoved ||
+        options.bandRows < 2) {
+        error("can't carve " + inputPath + " (" + std::to_string(size.width) + "x" + std::to_string(size.height) +
+              ") by " + std::to_string(colsToRemove) + " columns in bands of " + std::to_string(options.bandRows) +
+              " rows, the height can't be changed");
+        return false;
+    }
+
+    const cv::Size carvedSize(size.width - colsToRemove, size.height);
+    BandWriter writer;
+    if (!writer.open(outputPath, carvedSize, reader.type)) {
+        error("can't write " + outputPath);
+        return false;
+    }
+
+    SeamContext context;
+    cv::Mat band, energyImage, carved;
+    std::vector<std::vector<int>> seams, bandSeams(colsToRemove);
+    std::vector<int> starts;
+    int nbands = 0;
+    for (int begin = 0, end = 0; begin < size.height; begin = end, nbands++) {
+        end = std::min(begin + options.bandRows, size.height);
+        /* the dynamic programming starts with the last row of the band above, where the seams continue, and
+           the energy needs one more row on either side */
+        const int first = begin > 0 ? begin - 1 : 0;
+        const int readBegin = std::max(first - 1, 0), readEnd = std::min(end + 1, size.height);
+        if (!reader.read(readBegin, readEnd, band)) {
+            error("can't read rows " + std::to_string(readBegin) + " to " + std::to_string(readEnd) + " of " +
+                  inputPath);
+            return false;
+        }
+        seam::energy(band, energyImage, options.function);
+        cv::Mat bandEnergy = energyImage.rowRange(first - readBegin, end - readBegin);
+
+        context.reset(bandEnergy.rows, bandEnergy.cols);
+        if (!findBandSeams(bandEnergy, context, colsToRemove, starts, seams)) {
+            /* the seams of the first band may cross, they start at the pixels of its first row with the lowest
+               energy then, on the energy without their marks */
+            SEAM_COUNT("stream_first_band_restarts", 1);
+            seam::energy(band, energyImage, options.function);
+            starts = lowestEnergyColumns(bandEnergy, colsToRemove);
+            context.reset(bandEnergy.rows, bandEnergy.cols);
+            findBandSeams(bandEnergy, context, colsToRemove, starts, seams);
+        }
+
+        {
+            SEAM_SCOPED_TIMER("stream.delete");
+            /* the row of the band above was written already */
+            for (int k = 0; k < colsToRemove; k++)
+                bandSeams[k].assign(seams[k].begin() + (begin - first), seams[k].end());
+            seam::deleteSeamsVertical(band.rowRange(begin - readBegin, end - readBegin), carved, bandSeams);
+        }
+        if (!writer.write(carved)) {
+            error("can't write " + outputPath);
+            return false;
+        }
+    }
+    if (!writer.close()) {
+        error("can't write " + outputPath);
+        return false;
+    }
+    std::cout << inputPath << " -> " << outputPath << " (" << carvedSize.width << "x" << carvedSize.height << ", "
+              << nbands << " bands)\n";
+    return true;
+}
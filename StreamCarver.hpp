@@ -0,0 +1,30 @@
+#ifndef STREAMCARVER_HPP
+#define STREAMCARVER_HPP
+
+#include <string>
+
+#include "BatchCarver.hpp"
+
+namespace seam {
+    /**
+     * @brief Removes columns of an image, which doesn't need to fit into memory, in bands of rows.
+     * @param inputPath - a binary PGM or PPM file, which is read band by band, or any image ImageReader reads.
+     * @param outputPath - a PGM or PPM file, which is written band by band, or any image cv::imwrite writes.
+     * @param options - the width or number of columns, the energy function and the rows per band. The height
+     *        can't be changed.
+     * @return false, if the image can't be read, carved or written.
+     *
+     * @details Only one band of options.bandRows rows is held in memory at a time with its energy and
+     * dynamic programming table, so the memory doesn't grow with the height of the image. The seams of the
+     * first band are computed like by "Compute Seams". Every later band also holds the last row of the band
+     * above, and each seam continues there, where a seam of the band above ended, see seamVertical() with a
+     * start column. The seams are searched from left to right, so each one has room right of the ones before.
+     * The seams are connected from band to band, but each band only sees its own rows, so the seams are
+     * optimal within every band instead of the whole image. The seams of a band are deleted and the band is
+     * written, before the next one is read. Other formats than PGM and PPM are decoded or encoded at once.
+     * Progress and errors are reported on stdout and stderr.
+     */
+    bool carveStream(const std::string& inputPath, const std::string& outputPath, const BatchOptions& options);
+} // namespace seam
+
+#endif // STREAMCARVER_HPP
@@ -0,0 +1,295 @@
+#include "VideoCarver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "opencv2/videoio/videoio.hpp"
+#include "BoundedQueue.hpp"
+#include "Instrumentation.hpp"
+#include "SeamContext.hpp"
+
+namespace {
+    /**
+     * @brief One frame on its way through the pipeline.
+     */
+    struct Frame {
+        int index = 0;
+        cv::Mat image;
+        cv::Mat verticalEnergy;
+        cv::Mat horizontalEnergy;
+        std::vector<std::vector<int>> seamsVertical;
+        std::vector<std::vector<int>> seamsHorizontal;
+        /* the image is carved already, its seams crossed each other */
+        bool carved = false;
+    };
+
+    typedef seam::BoundedQueue<Frame> FrameQueue;
+
+    /**
+     * @brief Shared state of a video run.
+     */
+    struct Video {
+        const seam::BatchOptions& options;
+        int colsToRemove;
+        int rowsToRemove;
+        std::atomic<bool> failed;
+        std::mutex reportMutex;
+        /* the queues between the stages, which are all closed if one of them fails */
+        std::vector<FrameQueue*> queues;
+
+        explicit Video(const seam::BatchOptions& options) :
+            options(options), colsToRemove(0), rowsToRemove(0), failed(false) {}
+
+        void error(const std::string& message)
+        {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            std::cerr << "error: " << message << "\n";
+        }
+
+        /* stops all stages, the frames which already passed a stage are still written */
+        void abort()
+        {
+            failed = true;
+            for (FrameQueue* queue : queues)
+                queue->close();
+        }
+    };
+
+    /**
+     * @brief The seams of the previous frame and the working memory of the seam search.
+     */
+    struct SeamSearch {
+        seam::SeamContext verticalContext;
+        seam::SeamContext horizontalContext;
+        std::vector<std::vector<int>> previousVertical;
+        std::vector<std::vector<int>> previousHorizontal;
+    };
+
+    /**
+     * @brief Finds count seams of one direction, the k-th one around guides[k], if there is one.
+     * @return false, if the frame has fewer seams, which don't cross each other.
+     */
+    bool findSeams(cv::Mat& energy, seam::SeamContext& context, bool horizontal, int count,
+                   const std::vector<std::vector<int>>& guides, int corridor, std::vector<std::vector<int>>& seams)
+    {
+        std::vector<int> seam;
+        for (int k = 0; k < count; k++) {
+            bool found;
+            if (k < static_cast<int>(guides.size()))
+                found = horizontal ? seam::seamHorizontal(energy, context, guides[k], corridor, seam)
+                                   : seam::seamVertical(energy, context, guides[k], corridor, seam);
+            else
+                found = horizontal ? seam::seamHorizontal(energy, context, seam)
+                                   : seam::seamVertical(energy, context, seam);
+            if (!found)
+                return false;
+            seams.push_back(seam);
+        }
+        return true;
+    }
+
+    bool computeEnergy(Video& video, Frame& frame)
+    {
+        SEAM_SCOPED_TIMER("video.energy");
+        /* forward energy differs for horizontal seams, and the seams are marked on the energy */
+        if (video.colsToRemove > 0)
+            seam::energy(frame.image, frame.verticalEnergy, video.options.function);
+        if (video.rowsToRemove > 0)
+            seam::energy(frame.image, frame.horizontalEnergy, video.options.function, cv::Mat(), true);
+        return true;
+    }
+
+    /**
+     * @brief Finds the seams of both directions in a fresh context.
+     */
+    bool findFrameSeams(Video& video, SeamSearch& search, Frame& frame, bool guided)
+    {
+        const std::vector<std::vector<int>> noGuides;
+        /* for horizontal seams the rows of the context are the columns of the frame */
+        search.verticalContext.reset(frame.image.rows, frame.image.cols);
+        search.horizontalContext.reset(frame.image.cols, frame.image.rows);
+        frame.seamsVertical.clear();
+        frame.seamsHorizontal.clear();
+        return findSeams(frame.verticalEnergy, search.verticalContext, false, video.colsToRemove,
+                         guided ? search.previousVertical : noGuides, video.options.corridor, frame.seamsVertical) &&
+               findSeams(frame.horizontalEnergy, search.horizontalContext, true, video.rowsToRemove,
+                         guided ? search.previousHorizontal : noGuides, video.options.corridor,
+                         frame.seamsHorizontal);
+    }
+
+    bool searchSeams(Video& video, SeamSearch& search, Frame& frame)
+    {
+        SEAM_SCOPED_TIMER("video.seams");
+        const int interval = video.options.keyframeInterval;
+        bool keyframe = frame.index == 0 || (interval > 0 && frame.index % interval == 0) ||
+                        (search.previousVertical.empty() && search.previousHorizontal.empty());
+
+        if (!keyframe && !findFrameSeams(video, search, frame, true)) {
+            /* the guided seams can leave no room for the last ones, the frame becomes a keyframe then and its
+               energy is computed again without the marks of the guided seams */
+            SEAM_COUNT("video_guide_restarts", 1);
+            computeEnergy(video, frame);
+            keyframe = true;
+        }
+        if (keyframe && !findFrameSeams(video, search, frame, false)) {
+            /* not enough seams don't cross each other, so they are removed one by one like by carve(), and the
+               next frame has no guides */
+            SEAM_COUNT("video_carved_frames", 1);
+            cv::Mat carvedImage;
+            seam::carve(frame.image, carvedImage, video.colsToRemove, video.rowsToRemove, video.options.function);
+            frame.image = carvedImage;
+            frame.carved = true;
+            frame.seamsVertical.clear();
+            frame.seamsHorizontal.clear();
+        } else if (keyframe) {
+            SEAM_COUNT("video_keyframes", 1);
+        } else {
+            SEAM_COUNT("video_guided_frames", 1);
+        }
+        search.previousVertical = frame.seamsVertical;
+        search.previousHorizontal = frame.seamsHorizontal;
+
+        frame.verticalEnergy.release();
+        frame.horizontalEnergy.release();
+        return true;
+    }
+
+    bool deleteFrameSeams(Frame& frame)
+    {
+        SEAM_SCOPED_TIMER("video.delete");
+        if (frame.carved)
+            return true;
+        cv::Mat carved;
+        seam::deleteSeams(frame.image, carved, frame.seamsVertical, frame.seamsHorizontal);
+        frame.image = carved;
+        return true;
+    }
+
+    /**
+     * @brief Starts the thread of one stage. It takes the frames from input in order, processes them and passes
+     * them on to output. If work fails, all stages are stopped.
+     * @param output - the queue of the next stage, nullptr for the last stage.
+     */
+    template <typename Work>
+    void startStage(Video& video, FrameQueue& input, FrameQueue* output, Work work, std::vector<std::thread>& threads)
+    {
+        threads.emplace_back([&video, &input, output, work] {
+            Frame frame;
+            while (!video.failed && input.pop(frame)) {
+                bool success = false;
+                try {
+                    success = work(frame);
+                } catch (const std::exception& exception) {
+                    /* cv::Exception and e.g. std::bad_alloc must not escape the thread, which would terminate */
+                    video.error("frame " + std::to_string(frame.index) + ": " + exception.what());
+                }
+                if (!success) {
+                    video.abort();
+                    break;
+                }
+                if (output)
+                    output->push(std::move(frame));
+                frame = Frame();
+            }
+            if (output)
+                output->close();
+        });
+    }
+
+    int fourcc(const std::string& code)
+    {
+        return cv::VideoWriter::fourcc(code[0], code[1], code[2], code[3]);
+    }
+} // namespace
+
+bool seam::carveVideo(const std::string& inputPath, const std::string& outputPath, const BatchOptions& options)
+{
+    Video video(options);
+    cv::VideoCapture capture(inputPath);
+    if (!capture.isOpened()) {
+        video.error("can't read " + inputPath);
+        return false;
+    }
+    const cv::Size size(static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+                        static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    video.colsToRemove = options.cols >= 0 ? options.cols : options.width >= 0 ? size.width - options.width : 0;
+    video.rowsToRemove = options.rows >= 0 ? options.rows : options.height >= 0 ? size.height - options.height : 0;
+    if (video.colsToRemove < 0 || video.colsToRemove > size.width - 3 ||
+        video.rowsToRemove < 0 || video.rowsToRemove > size.height - 3) {
+        video.error("can't carve " + inputPath + " (" + std::to_string(size.width) + "x" +
+                    std::to_string(size.height) + ") by " + std::to_string(video.colsToRemove) + " columns and " +
+                    std::to_string(video.rowsToRemove) + " rows");
+        return false;
+    }
+
+    /* the codec and frame rate of the input, unless they are unknown */
+    const int code = options.fourcc.size() == 4 ? fourcc(options.fourcc)
+                                                : static_cast<int>(capture.get(cv::CAP_PROP_FOURCC));
+    const double fps = capture.get(cv::CAP_PROP_FPS);
+    const cv::Size carvedSize(size.width - video.colsToRemove, size.height - video.rowsToRemove);
+    cv::VideoWriter writer(outputPath, code != 0 ? code : fourcc("mp4v"), fps > 0 ? fps : 25.0, carvedSize);
+    if (!writer.isOpened()) {
+        video.error("can't write " + outputPath);
+        return false;
+    }
+
+    const size_t capacity = static_cast<size_t>(std::max(1, options.queueCapacity));
+    FrameQueue decodedQueue(capacity), energyQueue(capacity), seamQueue(capacity), carvedQueue(capacity);
+    video.queues = { &decodedQueue, &energyQueue, &seamQueue, &carvedQueue };
+    SeamSearch search;
+    int written = 0;
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] {
+        Frame frame;
+        int index = 0;
+        try {
+            for (; !video.failed; index++) {
+                {
+                    SEAM_SCOPED_TIMER("video.decode");
+                    if (!capture.read(frame.image))
+                        break;
+                }
+                if (frame.image.size() != size) {
+                    video.error("frame " + std::to_string(index) + " of " + inputPath + " has another size");
+                    video.abort();
+                    break;
+                }
+                frame.index = index;
+                if (!decodedQueue.push(std::move(frame)))
+                    break;
+                frame = Frame();
+            }
+        } catch (const std::exception& exception) {
+            /* like the other stages, see startStage() */
+            video.error("frame " + std::to_string(index) + " of " + inputPath + ": " + exception.what());
+            video.abort();
+        }
+        decodedQueue.close();
+    });
+    startStage(video, decodedQueue, &energyQueue, [&video](Frame& frame) { return computeEnergy(video, frame); },
+               threads);
+    startStage(video, energyQueue, &seamQueue,
+               [&video, &search](Frame& frame) { return searchSeams(video, search, frame); }, threads);
+    startStage(video, seamQueue, &carvedQueue, deleteFrameSeams, threads);
+    startStage(video, carvedQueue, nullptr, [&writer, &written](Frame& frame) {
+        SEAM_SCOPED_TIMER("video.encode");
+        writer.write(frame.image);
+        written++;
+        return true;
+    }, threads);
+
+    for (std::thread& thread : threads)
+        thread.join();
+    writer.release();
+
+    std::lock_guard<std::mutex> lock(video.reportMutex);
+    std::cout << inputPath << " -> " << outputPath << " (" << carvedSize.width << "x" << carvedSize.height << ", "
+              << written << " frames)\n";
+    return !video.failed;
+}
@@ -0,0 +1,32 @@
+#ifndef VIDEOCARVER_HPP
+#define VIDEOCARVER_HPP
+
+#include <string>
+
+#include "BatchCarver.hpp"
+
+namespace seam {
+    /**
+     * @brief Carves every frame of a video to the same size with seams, which follow the seams of the previous
+     * frame.
+     * @param inputPath - a video, which cv::VideoCapture can read.
+     * @param outputPath - the carved video, written with cv::VideoWriter.
+     * @param options - the size, energy function, queue capacity and the video options of a batch run.
+     * @return false, if the video can't be read or written, or a frame can't be carved. The frames before are
+     *         written then.
+     *
+     * @details The seams of both directions are computed on the energy of each frame like by "Compute Seams"
+     * and then deleted in one pass. Only the first frame and every keyframeInterval-th one search the full
+     * frame. The k-th seam of every other frame is searched in a corridor around the k-th seam of the previous
+     * frame, see seamVertical() with a guide, so the seams don't jump between frames and the cost per seam
+     * doesn't depend on the width of the frame. If the guided seams leave no room for the last ones, the frame
+     * is searched again like a keyframe, and if the seams of a frame always cross, it is carved like by carve().
+     * Reading, the energy, the seam search, the deletion and writing run on threads of their own and pass the
+     * frames on through bounded queues, so the stages of consecutive frames overlap. The seam search depends
+     * on the previous frame and runs on one thread, the energy and the deletion use all threads of OpenCV.
+     * Progress and errors are reported on stdout and stderr.
+     */
+    bool carveVideo(const std::string& inputPath, const std::string& outputPath, const BatchOptions& options);
+} // namespace seam
+
+#endif // VIDEOCARVER_HPP
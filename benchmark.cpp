@@ -0,0 +1,627 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "ImageReader.hpp"
+#include "SeamFunctions.hpp"
+#include "SeamMap.hpp"
+
+/* Every heap allocation of the C++ runtime is counted, which includes the seams and the SeamContext buffers.
+ * cv::Mat buffers come from cv::fastMalloc and are not counted. */
+static std::atomic<long> allocationCount(0);
+
+void* operator new(std::size_t size)
+{
+    allocationCount++;
+    if (void* pointer = std::malloc(size > 0 ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    struct Resolution {
+        const char* name;
+        int cols;
+        int rows;
+    };
+
+    const Resolution resolutions[] = {
+        {"vga", 640, 480},
+        {"hd", 1280, 720},
+        {"fhd", 1920, 1080},
+        {"4k", 3840, 2160},
+        {"8k", 7680, 4320}
+    };
+
+    /**
+     * @brief Number of seams to compute, either absolute or in percent of the width (height for horizontal seams).
+     */
+    struct SeamCount {
+        int value;
+        bool percent;
+
+        int seams(int size) const { return std::max(1, std::min(size - 3, percent ? size * value / 100 : value)); }
+        std::string name() const { return std::to_string(value) + (percent ? "%" : ""); }
+    };
+
+    struct Options {
+        std::vector<Resolution> resolutions;
+        std::vector<SeamCount> counts;
+        std::vector<std::string> images;
+        std::string filter;
+        std::string jsonPath;
+        double minTime = 0.5;
+    };
+
+    /**
+     * @brief Measured values of one benchmark, all per iteration.
+     */
+    struct Result {
+        std::string name;
+        int iterations;
+        double milliseconds;
+        int seams;
+        double pixelsPerSecond;
+        double allocations;
+    };
+
+    /**
+     * @brief Runs and reports the benchmarks.
+     */
+    class Runner
+    {
+    public:
+        explicit Runner(const Options& options) : options(options) {}
+
+        /**
+         * @brief Runs body until the minimum time is reached, but at least once.
+         * @param name - unique name, skipped if it doesn't contain the filter.
+         * @param pixels - number of pixels processed by one run of body.
+         * @param seams - number of seams computed by one run of body, 0 if it doesn't compute seams.
+         * Both are read after the runs, so that body can count them.
+         * @param setup - prepares the input of body, not measured.
+         * @param body - the measured code.
+         */
+        void run(const std::string& name, const double& pixels, const int& seams, const std::function<void()>& setup,
+                 const std::function<void()>& body)
+        {
+            if (!selected(name))
+                return;
+
+            Clock::duration total = Clock::duration::zero();
+            long allocations = 0;
+            int iterations = 0;
+            do {
+                setup();
+                long allocationsBefore = allocationCount;
+                Clock::time_point start = Clock::now();
+                body();
+                total += Clock::now() - start;
+                allocations += allocationCount - allocationsBefore;
+                iterations++;
+            } while (std::chrono::duration<double>(total).count() < options.minTime);
+
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.milliseconds = std::chrono::duration<double, std::milli>(total).count() / iterations;
+            result.seams = seams;
+            result.pixelsPerSecond = pixels / (result.milliseconds / 1000.0);
+            result.allocations = static_cast<double>(allocations) / iterations;
+            print(result);
+            results.push_back(result);
+        }
+
+        /**
+         * @brief Whether the benchmark with this name runs, to skip expensive setups of filtered benchmarks.
+         */
+        bool selected(const std::string& name) const { return name.find(options.filter) != std::string::npos; }
+
+        const std::vector<Result>& getResults() const { return results; }
+
+    private:
+        void print(const Result& result) const
+        {
+            std::cout << std::left << std::setw(56) << result.name << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(12) << result.milliseconds << " ms";
+            if (result.seams > 0)
+                std::cout << std::setw(10) << result.milliseconds / result.seams << " ms/seam";
+            else
+                std::cout << std::setw(18) << "";
+            std::cout << std::setprecision(1) << std::setw(10) << result.pixelsPerSecond / 1e6 << " Mpx/s"
+                      << std::setw(10) << result.allocations << " allocs" << std::setw(6) << result.iterations
+                      << " it\n";
+        }
+
+        const Options& options;
+        std::vector<Result> results;
+    };
+
+    /**
+     * @brief Deterministic test image with smooth regions, edges and fine texture.
+     */
+    cv::Mat syntheticImage(int rows, int cols)
+    {
+        cv::Mat image(rows, cols, CV_8UC3);
+        uint32_t state = 12345;
+        for (int i = 0; i < rows; i++) {
+            cv::Vec3b* row = image.ptr<cv::Vec3b>(i);
+            for (int j = 0; j < cols; j++) {
+                state = state * 1664525u + 1013904223u;
+                int noise = static_cast<int>(state >> 28);
+                double x = static_cast<double>(j) / cols, y = static_cast<double>(i) / rows;
+                int blocks = ((j / 97) + (i / 61)) % 2 * 60;
+                int wave = static_cast<int>(60 * std::sin(x * 40) * std::cos(y * 25));
+                row[j] = cv::Vec3b(cv::saturate_cast<uchar>(80 + blocks + wave + noise),
+                                   cv::saturate_cast<uchar>(120 + wave + noise),
+                                   cv::saturate_cast<uchar>(200 * x + blocks + noise));
+            }
+        }
+        return image;
+    }
+
+    /**
+     * @brief Recomputes the energy sum of a vertical seam like the dynamic programming adds it up: forward energy
+     * has the cost of every predecessor of a pixel in its own channel, left, up and right.
+     */
+    uint64_t seamEnergy(const cv::Mat& energyImage, const std::vector<int>& seam)
+    {
+        const int nChannels = energyImage.channels();
+        uint64_t sum = 0;
+        for (int i = 0; i < energyImage.rows; i++) {
+            const int predecessor = nChannels == 1 ? 0 : i == 0 ? 1 : seam[i-1] - seam[i] + 1;
+            sum += energyImage.ptr<uchar>(i)[seam[i] * nChannels + predecessor];
+        }
+        return sum;
+    }
+
+    /**
+     * @brief Checks that the seam search returns the energy sum of its seams, which e.g. the transport map of
+     * optimalSeamOrder() adds up, for both directions and every energy function.
+     * @return false, if a check failed, which is reported.
+     */
+    bool checkSeamCosts(const cv::Mat& image)
+    {
+        const seam::EnergyFunction functions[] = {seam::ENERGY_SOBEL, seam::ENERGY_SCHARR, seam::ENERGY_FORWARD};
+        bool passed = true;
+        for (seam::EnergyFunction function : functions) {
+            for (int horizontal = 0; horizontal < 2; horizontal++) {
+                cv::Mat energyImage, transposedEnergy;
+                seam::energy(image, energyImage, function, cv::Mat(), horizontal != 0);
+                /* horizontal seams are vertical seams of the transposed energy */
+                seam::transpose(energyImage, transposedEnergy);
+                const cv::Mat reference = horizontal ? transposedEnergy : energyImage.clone();
+                seam::SeamContext context(reference.rows, reference.cols);
+                std::vector<int> seam;
+                uint32_t cost = 0;
+                /* the later seams are found in the energy sums, which were updated after blocking */
+                for (int s = 0; s < 3; s++) {
+                    const bool found = horizontal ? seam::seamHorizontal(energyImage, context, seam, &cost)
+                                                  : seam::seamVertical(energyImage, context, seam, &cost);
+                    if (!found || cost != seamEnergy(reference, seam)) {
+                        std::cerr << "error: seam " << s << (horizontal ? " horizontal" : " vertical")
+                                  << " with energy function " << function << " costs " << cost << ", its pixels "
+                                  << (found ? seamEnergy(reference, seam) : 0) << "\n";
+                        passed = false;
+                        break;
+                    }
+                }
+            }
+        }
+        return passed;
+    }
+
+    /**
+     * @brief Removes the seams of an order one at a time, each the cheapest one of the image carved so far like
+     * the transport map computes them, and returns the sum of their costs.
+     */
+    uint64_t orderCost(cv::Mat image, const std::vector<bool>& order, seam::EnergyFunction function)
+    {
+        uint64_t total = 0;
+        for (bool vertical : order) {
+            cv::Mat energyImage, carvedImage;
+            seam::energy(image, energyImage, function, cv::Mat(), !vertical);
+            std::vector<std::vector<int>> seams(1);
+            uint32_t cost = 0;
+            if (vertical) {
+                seam::SeamContext context(image.rows, image.cols);
+                seam::seamVertical(energyImage, context, seams[0], &cost);
+                seam::deleteSeamsVertical(image, carvedImage, seams);
+            } else {
+                seam::SeamContext context(image.cols, image.rows);
+                seam::seamHorizontal(energyImage, context, seams[0], &cost);
+                seam::deleteSeamsHorizontal(image, carvedImage, seams);
+            }
+            total += cost;
+            image = carvedImage;
+        }
+        return total;
+    }
+
+    /**
+     * @brief Checks optimalSeamOrder() against the cheapest of all orders, which are few enough for three columns
+     * and three rows. On the image the cheapest order of every energy function is unique and doesn't remove all
+     * rows first, so an order, which ignores the costs, fails.
+     * @return false, if a check failed, which is reported.
+     */
+    bool checkSeamOrder(const cv::Mat& image)
+    {
+        const seam::EnergyFunction functions[] = {seam::ENERGY_SOBEL, seam::ENERGY_SCHARR, seam::ENERGY_FORWARD};
+        const int cols = 3, rows = 3;
+        bool passed = true;
+        for (seam::EnergyFunction function : functions) {
+            std::vector<bool> order, cheapestOrder;
+            seam::optimalSeamOrder(image, order, cols, rows, function);
+
+            /* false sorts first, so the permutations start with all horizontal seams */
+            std::vector<bool> candidate(rows, false);
+            candidate.resize(rows + cols, true);
+            const std::vector<bool> rowsFirst = candidate;
+            uint64_t cheapest = UINT64_MAX;
+            do {
+                const uint64_t cost = orderCost(image, candidate, function);
+                if (cost < cheapest) {
+                    cheapest = cost;
+                    cheapestOrder = candidate;
+                }
+            } while (std::next_permutation(candidate.begin(), candidate.end()));
+
+            if (order != cheapestOrder || order == rowsFirst) {
+                std::cerr << "error: seam order with energy function " << function << " costs "
+                          << orderCost(image, order, function) << ", the cheapest one " << cheapest << "\n";
+                passed = false;
+            }
+        }
+        return passed;
+    }
+
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    /**
+     * @brief Writes the results in the JSON layout of Google Benchmark, with the seam counters added.
+     */
+    bool writeJson(const std::string& path, const std::vector<Result>& results)
+    {
+        std::ofstream file(path);
+        file << std::setprecision(9) << "{\n  \"context\": {\n    \"executable\": \"seambench\",\n"
+             << "    \"num_cpus\": " << cv::getNumberOfCPUs() << ",\n"
+             << "    \"opencv_threads\": " << cv::getNumThreads() << "\n  },\n  \"benchmarks\": [";
+        for (size_t b = 0; b < results.size(); b++) {
+            const Result& result = results[b];
+            file << (b == 0 ? "\n" : ",\n")
+                 << "    {\n"
+                 << "      \"name\": \"" << escapeJson(result.name) << "\",\n"
+                 << "      \"run_type\": \"iteration\",\n"
+                 << "      \"iterations\": " << result.iterations << ",\n"
+                 << "      \"real_time\": " << result.milliseconds << ",\n"
+                 << "      \"time_unit\": \"ms\",\n"
+                 << "      \"seams\": " << result.seams << ",\n"
+                 << "      \"time_per_seam\": " << (result.seams > 0 ? result.milliseconds / result.seams : 0) << ",\n"
+                 << "      \"pixels_per_second\": " << result.pixelsPerSecond << ",\n"
+                 << "      \"allocations\": " << result.allocations << "\n"
+                 << "    }";
+        }
+        file << "\n  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+    /**
+     * @brief Runs all benchmarks for one image.
+     * @param label - "synthetic" or the file name of a real image.
+     */
+    void benchmarkImage(Runner& runner, const Options& options, const std::string& label, const cv::Mat& image)
+    {
+        const std::string prefix = "/" + label + "/" + std::to_string(image.cols) + "x" + std::to_string(image.rows);
+        const double pixels = static_cast<double>(image.rows) * image.cols;
+        cv::Mat energyImage, workImage, transposedEnergy;
+
+        cv::Mat grayscaleImage;
+        cv::cvtColor(image, grayscaleImage, cv::COLOR_BGR2GRAY);
+        runner.run("sobel" + prefix, pixels, 0, [] {}, [&] {
+            seam::sobel(grayscaleImage, energyImage);
+        });
+        runner.run("energy_scharr" + prefix, pixels, 0, [] {}, [&] {
+            seam::energy(image, energyImage, seam::ENERGY_SCHARR);
+        });
+        runner.run("energy_forward" + prefix, pixels, 0, [] {}, [&] {
+            seam::energy(image, energyImage, seam::ENERGY_FORWARD);
+        });
+        runner.run("transpose" + prefix, pixels, 0, [] {}, [&] {
+            seam::transpose(image, transposedEnergy);
+        });
+
+        seam::energy(image, energyImage);
+        for (const SeamCount& count : options.counts) {
+            const int verticalSeams = count.seams(image.cols);
+            const int horizontalSeams = count.seams(image.rows);
+            const std::string suffix = prefix + "/" + count.name();
+            std::vector<std::vector<int>> seamsVertical, seamsHorizontal;
+            seam::SeamContext context;
+
+            /* seam search stops early if all remaining seams would cross earlier ones */
+            int foundSeams = 0;
+            double searchedPixels = 0;
+            std::function<void()> setupVertical = [&] {
+                energyImage.copyTo(workImage);
+                context.reset(image.rows, image.cols);
+                seamsVertical.clear();
+            };
+            std::function<void()> searchVertical = [&] {
+                std::vector<int> seam;
+                for (int s = 0; s < verticalSeams && seam::seamVertical(workImage, context, seam); s++)
+                    seamsVertical.push_back(seam);
+                foundSeams = static_cast<int>(seamsVertical.size());
+                searchedPixels = pixels * foundSeams;
+            };
+            std::function<void()> setupHorizontal = [&] {
+                energyImage.copyTo(workImage);
+                context.reset(image.cols, image.rows);
+                seamsHorizontal.clear();
+            };
+            std::function<void()> searchHorizontal = [&] {
+                std::vector<int> seam;
+                for (int s = 0; s < horizontalSeams && seam::seamHorizontal(workImage, context, seam); s++)
+                    seamsHorizontal.push_back(seam);
+                foundSeams = static_cast<int>(seamsHorizontal.size());
+                searchedPixels = pixels * foundSeams;
+            };
+            runner.run("seamVertical" + suffix, searchedPixels, foundSeams, setupVertical, searchVertical);
+            runner.run("seamHorizontal" + suffix, searchedPixels, foundSeams, setupHorizontal, searchHorizontal);
+
+            /* the coarse-to-fine search builds its pyramid on the first seam, which is measured */
+            seam::SeamPyramid pyramid;
+            std::vector<std::vector<int>> pyramidSeams;
+            runner.run("seamVerticalPyramid" + suffix, searchedPixels, foundSeams, [&] {
+                energyImage.copyTo(workImage);
+                context.reset(image.rows, image.cols);
+                pyramid.clear();
+                pyramidSeams.clear();
+            }, [&] {
+                std::vector<int> seam;
+                for (int s = 0; s < verticalSeams && seam::seamVertical(workImage, context, pyramid, seam); s++)
+                    pyramidSeams.push_back(seam);
+                foundSeams = static_cast<int>(pyramidSeams.size());
+                searchedPixels = pixels * foundSeams;
+            });
+            runner.run("seamHorizontalPyramid" + suffix, searchedPixels, foundSeams, [&] {
+                energyImage.copyTo(workImage);
+                context.reset(image.cols, image.rows);
+                pyramid.clear();
+                pyramidSeams.clear();
+            }, [&] {
+                std::vector<int> seam;
+                for (int s = 0; s < horizontalSeams && seam::seamHorizontal(workImage, context, pyramid, seam); s++)
+                    pyramidSeams.push_back(seam);
+                foundSeams = static_cast<int>(pyramidSeams.size());
+                searchedPixels = pixels * foundSeams;
+            });
+
+            /* the deletion needs the seams, even if the seam search was filtered out */
+            if (seamsVertical.empty()) {
+                setupVertical();
+                searchVertical();
+            }
+            if (seamsHorizontal.empty()) {
+                setupHorizontal();
+                searchHorizontal();
+            }
+            if (seamsVertical.empty() || seamsHorizontal.empty())
+                continue;
+
+            cv::Mat verticalDeletedImage, seamsDeletedImage;
+            runner.run("deleteSeamsVertical" + suffix, pixels, static_cast<int>(seamsVertical.size()), [] {}, [&] {
+                seam::deleteSeamsVertical(image, verticalDeletedImage, seamsVertical);
+            });
+
+            std::vector<std::vector<int>> combinedSeams;
+            runner.run("combineVerticalHorizontalSeams" + suffix, pixels, static_cast<int>(seamsHorizontal.size()),
+                       [&] { combinedSeams = seamsHorizontal; }, [&] {
+                seam::combineVerticalHorizontalSeams(seamsVertical, combinedSeams);
+            });
+
+            runner.run("deleteSeams" + suffix, pixels, static_cast<int>(seamsVertical.size() + seamsHorizontal.size()),
+                       [] {}, [&] {
+                seam::deleteSeams(image, seamsDeletedImage, seamsVertical, seamsHorizontal);
+            });
+
+            /* the two step deletion needs the results of the first step, even if it was filtered out */
+            if (verticalDeletedImage.empty()) {
+                seam::deleteSeamsVertical(image, verticalDeletedImage, seamsVertical);
+                combinedSeams = seamsHorizontal;
+                seam::combineVerticalHorizontalSeams(seamsVertical, combinedSeams);
+            }
+            runner.run("deleteSeamsHorizontal" + suffix, pixels, static_cast<int>(combinedSeams.size()), [] {}, [&] {
+                seam::deleteSeamsHorizontal(verticalDeletedImage, seamsDeletedImage, combinedSeams);
+            });
+        }
+
+        for (const SeamCount& count : options.counts) {
+            const int seams = count.seams(image.cols);
+            cv::Mat carvedImage;
+            runner.run("carveVertical" + prefix + "/" + count.name(), pixels * seams, seams, [] {}, [&] {
+                seam::carveVertical(image, carvedImage, seams);
+            });
+        }
+
+        /* the seam map carves the whole image once, so it is only computed if a retarget benchmark runs */
+        seam::SeamMap seamMap;
+        for (const SeamCount& count : options.counts) {
+            const std::string name = "seamMapRetarget" + prefix + "/" + count.name();
+            if (!runner.selected(name))
+                continue;
+            if (seamMap.empty())
+                seamMap.compute(image);
+            const int cols = count.seams(image.cols), rows = count.seams(image.rows);
+            cv::Mat retargetedImage;
+            runner.run(name, pixels, 0, [] {}, [&] {
+                seamMap.retarget(image.cols - cols, image.rows - rows, retargetedImage);
+            });
+        }
+    }
+
+    void printUsage(const char* program)
+    {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  --sizes <list>     resolutions out of vga,hd,fhd,4k,8k (default: all)\n"
+                  << "  --seams <list>     seam counts, absolute or in percent of the width (default: 1,10%,50%)\n"
+                  << "  --image <path>     benchmark a real image scaled to every resolution, repeatable\n"
+                  << "  --filter <text>    only run benchmarks whose name contains text\n"
+                  << "  --min-time <sec>   minimum measured time per benchmark (default: 0.5)\n"
+                  << "  --json <path>      write the results as JSON\n";
+    }
+
+    std::vector<std::string> split(const std::string& list)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty())
+                items.push_back(item);
+        return items;
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        std::string sizes = "vga,hd,fhd,4k,8k";
+        std::string counts = "1,10%,50%";
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            std::string value = argv[++i];
+            if (argument == "--sizes")
+                sizes = value;
+            else if (argument == "--seams")
+                counts = value;
+            else if (argument == "--image")
+                options.images.push_back(value);
+            else if (argument == "--filter")
+                options.filter = value;
+            else if (argument == "--min-time")
+                options.minTime = std::atof(value.c_str());
+            else if (argument == "--json")
+                options.jsonPath = value;
+            else
+                return false;
+        }
+
+        for (const std::string& size : split(sizes)) {
+            const Resolution* end = resolutions + sizeof(resolutions) / sizeof(resolutions[0]);
+            const Resolution* resolution = std::find_if(resolutions, end, [&](const Resolution& r) {
+                return size == r.name;
+            });
+            if (resolution == end)
+                return false;
+            options.resolutions.push_back(*resolution);
+        }
+        for (const std::string& count : split(counts)) {
+            SeamCount seamCount;
+            seamCount.percent = count.back() == '%';
+            seamCount.value = std::atoi(count.c_str());
+            if (seamCount.value <= 0 || (seamCount.percent && seamCount.value >= 100))
+                return false;
+            options.counts.push_back(seamCount);
+        }
+        return true;
+    }
+} // namespace
+
+/**
+ * @brief Microbenchmarks of the seam:: kernels on synthetic and real images at several resolutions.
+ * Reports the time per call and per seam, the throughput in pixels per second and the heap allocations.
+ * Results, which the measurements can't see, are checked first on a small image, so broken kernels fail instead.
+ */
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    const cv::Mat checkImage = syntheticImage(48, 64);
+    if (!checkSeamCosts(checkImage) || !checkSeamOrder(checkImage))
+        return 1;
+
+    std::vector<std::pair<std::string, cv::Mat>> sources;
+    sources.emplace_back("synthetic", cv::Mat());
+    for (const std::string& path : options.images) {
+        cv::Mat image = ImageReader::readImage(path);
+        if (image.empty()) {
+            std::cerr << "error: can't read " << path << "\n";
+            return 1;
+        }
+        std::string::size_type slash = path.find_last_of("/\\");
+        sources.emplace_back(slash == std::string::npos ? path : path.substr(slash + 1), image);
+    }
+
+    Runner runner(options);
+    for (const Resolution& resolution : options.resolutions) {
+        for (const std::pair<std::string, cv::Mat>& source : sources) {
+            cv::Mat image;
+            if (source.second.empty())
+                image = syntheticImage(resolution.rows, resolution.cols);
+            else
+                cv::resize(source.second, image, cv::Size(resolution.cols, resolution.rows), 0, 0, cv::INTER_AREA);
+            benchmarkImage(runner, options, source.first, image);
+        }
+    }
+
+    if (!options.jsonPath.empty() && !writeJson(options.jsonPath, runner.getResults())) {
+        std::cerr << "error: can't write " << options.jsonPath << "\n";
+        return 1;
+    }
+    return 0;
+}
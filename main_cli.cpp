@@ -0,0 +1,222 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "BatchCarver.hpp"
+#include "Instrumentation.hpp"
+#include "StreamCarver.hpp"
+#include "VideoCarver.hpp"
+
+namespace {
+    void printUsage(const char* program)
+    {
+        std::cerr << "Usage: " << program << " [options] -o <output directory> <input>...\n"
+                  << "       " << program << " --video [options] -o <output video> <input video>\n"
+                  << "       " << program << " --stream [options] -o <output image> <input image>\n"
+                  << "\n"
+                  << "Inputs are image paths or glob patterns like 'images/*.jpg'.\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  -o, --output <dir>     directory for the carved images (must exist)\n"
+                  << "  -W, --width <pixels>   target width\n"
+                  << "  -H, --height <pixels>  target height\n"
+                  << "  -c, --cols <n>         number of vertical seams to remove\n"
+                  << "  -r, --rows <n>         number of horizontal seams to remove\n"
+                  << "  -e, --energy <name>    sobel (default), scharr or forward\n"
+                  << "  -j, --jobs <n>         carve threads (default: one per core)\n"
+                  << "      --decoders <n>     decode threads (default: 1)\n"
+                  << "      --encoders <n>     encode threads (default: 1)\n"
+                  << "      --queue <n>        images waiting between two stages (default: 4)\n"
+                  << "      --cache <dir>      reuse the seams of images carved before, stored in dir (must exist)\n"
+                  << "      --optimal          remove the seams of both directions in the order with the lowest energy\n"
+                  << "      --mmap             read and write binary PGM and PPM files memory mapped\n"
+                  << "      --video            carve the frames of a video, the seams follow those of the previous frame\n"
+                  << "      --corridor <n>     video: pixels on either side of the previous seams to search (default: 4)\n"
+                  << "      --keyframes <n>    video: search the full frame every n frames (default: first frame only)\n"
+                  << "      --fourcc <code>    video: codec of the output, e.g. mp4v (default: codec of the input)\n"
+                  << "      --stream           remove columns of an image larger than memory in bands of rows\n"
+                  << "      --band <rows>      stream: rows per band (default: 512)\n"
+                  << "      --stats            print the time spent per stage and counters to stderr\n"
+                  << "      --stats-json <path> write the same statistics as JSON\n"
+                  << "  -h, --help             show this help\n";
+    }
+
+    bool parseInt(const std::string& text, int& value)
+    {
+        char* end = nullptr;
+        long parsed = std::strtol(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || parsed < 0 || parsed > 1000000)
+            return false;
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    bool parseEnergy(const std::string& text, seam::EnergyFunction& function)
+    {
+        if (text == "sobel")
+            function = seam::ENERGY_SOBEL;
+        else if (text == "scharr")
+            function = seam::ENERGY_SCHARR;
+        else if (text == "forward")
+            function = seam::ENERGY_FORWARD;
+        else
+            return false;
+        return true;
+    }
+
+    /**
+     * @brief Expands the glob patterns among the inputs, plain paths are kept as they are.
+     */
+    std::vector<std::string> expandInputs(const std::vector<std::string>& inputs)
+    {
+        std::vector<std::string> paths;
+        for (const std::string& input : inputs) {
+            if (input.find_first_of("*?") == std::string::npos) {
+                paths.push_back(input);
+                continue;
+            }
+            std::vector<cv::String> matches;
+            cv::glob(input, matches, false);
+            if (matches.empty())
+                std::cerr << "warning: no files match " << input << "\n";
+            paths.insert(paths.end(), matches.begin(), matches.end());
+        }
+        return paths;
+    }
+} // namespace
+
+/**
+ * @brief Command line batch carver. Carves every input image to the same target size or by the same number
+ * of seams without a display, so it can be scripted on render servers. The images are processed in a
+ * parallel pipeline, see seam::carveBatch().
+ */
+int main(int argc, char *argv[])
+{
+    seam::BatchOptions options;
+    std::vector<std::string> inputs;
+    bool printStats = false;
+    bool videoMode = false;
+    bool streamMode = false;
+    std::string statsPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "-h" || argument == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (argument == "--stats") {
+            printStats = true;
+            continue;
+        }
+        if (argument == "--optimal") {
+            options.optimalOrder = true;
+            continue;
+        }
+        if (argument == "--mmap") {
+            options.mappedFiles = true;
+            continue;
+        }
+        if (argument == "--video") {
+            videoMode = true;
+            continue;
+        }
+        if (argument == "--stream") {
+            streamMode = true;
+            continue;
+        }
+        if (argument.size() > 1 && argument[0] == '-') {
+            if (i + 1 >= argc) {
+                std::cerr << "error: missing value for " << argument << "\n";
+                return 2;
+            }
+            std::string value = argv[++i];
+            bool valid = true;
+            if (argument == "-o" || argument == "--output")
+                options.outputDirectory = value;
+            else if (argument == "-W" || argument == "--width")
+                valid = parseInt(value, options.width);
+            else if (argument == "-H" || argument == "--height")
+                valid = parseInt(value, options.height);
+            else if (argument == "-c" || argument == "--cols")
+                valid = parseInt(value, options.cols);
+            else if (argument == "-r" || argument == "--rows")
+                valid = parseInt(value, options.rows);
+            else if (argument == "-e" || argument == "--energy")
+                valid = parseEnergy(value, options.function);
+            else if (argument == "-j" || argument == "--jobs")
+                valid = parseInt(value, options.carveWorkers);
+            else if (argument == "--decoders")
+                valid = parseInt(value, options.decodeWorkers);
+            else if (argument == "--encoders")
+                valid = parseInt(value, options.encodeWorkers);
+            else if (argument == "--queue")
+                valid = parseInt(value, options.queueCapacity);
+            else if (argument == "--cache")
+                options.cacheDirectory = value;
+            else if (argument == "--corridor")
+                valid = parseInt(value, options.corridor);
+            else if (argument == "--keyframes")
+                valid = parseInt(value, options.keyframeInterval);
+            else if (argument == "--fourcc") {
+                options.fourcc = value;
+                valid = value.size() == 4;
+            }
+            else if (argument == "--band")
+                valid = parseInt(value, options.bandRows) && options.bandRows >= 2;
+            else if (argument == "--stats-json")
+                statsPath = value;
+            else {
+                std::cerr << "error: unknown option " << argument << "\n";
+                printUsage(argv[0]);
+                return 2;
+            }
+            if (!valid) {
+                std::cerr << "error: invalid value " << value << " for " << argument << "\n";
+                return 2;
+            }
+            continue;
+        }
+        inputs.push_back(argument);
+    }
+
+    if (options.outputDirectory.empty() || inputs.empty()) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if ((options.width >= 0 && options.cols >= 0) || (options.height >= 0 && options.rows >= 0)) {
+        std::cerr << "error: a target size and a seam count for the same direction can't be combined\n";
+        return 2;
+    }
+
+    int failed = 0;
+    if (videoMode || streamMode) {
+        /* the output is a file instead of a directory */
+        if (inputs.size() != 1 || (videoMode && streamMode)) {
+            std::cerr << "error: --video and --stream carve exactly one input\n";
+            return 2;
+        }
+        const bool carved = videoMode ? seam::carveVideo(inputs[0], options.outputDirectory, options)
+                                      : seam::carveStream(inputs[0], options.outputDirectory, options);
+        failed = carved ? 0 : 1;
+    } else {
+        std::vector<std::string> paths = expandInputs(inputs);
+        failed = seam::carveBatch(paths, options);
+        std::cout << paths.size() - failed << " of " << paths.size() << " images carved\n";
+    }
+
+    if (printStats)
+        seam::instrumentation::report(std::cerr);
+    if (!statsPath.empty()) {
+        std::ofstream statsFile(statsPath);
+        seam::instrumentation::reportJson(statsFile);
+        if (!statsFile) {
+            std::cerr << "error: can't write " << statsPath << "\n";
+            return 1;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}